@@ -0,0 +1,108 @@
+#include "banburismus.h"
+#include "cli_tools.h"
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: banburismus <numrotors> <messagefile> [--rules=<rules>] [--rules-file=<file>] [--min-overlap=<n>] "
+	       "[--margin=<decibans>] [--threads=<n>]";
+}
+
+// One message per line: "<message setting> <ciphertext>", where the ciphertext may be split into groups
+std::vector<bombe::BanburismusMessage> loadMessages(const std::string& filename)
+{
+	std::ifstream ifs(filename);
+	if(!ifs.is_open())
+	{
+		throw std::invalid_argument("Cannot open the message file " + filename);
+	}
+
+	std::vector<bombe::BanburismusMessage> messages;
+	std::string line;
+	while(std::getline(ifs, line, '\n'))
+	{
+		std::istringstream iss(line.substr(0, line.find('#')));
+		bombe::BanburismusMessage message;
+		if(!(iss >> message.indicator))
+		{
+			continue;
+		}
+		for(std::string group; iss >> group;)
+		{
+			message.ciphertext += group;
+		}
+		messages.push_back(std::move(message));
+	}
+	return messages;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		if(args.size() < 2)
+		{
+			throw std::invalid_argument("Cannot parse numrotors and message file\n");
+		}
+		const size_t num_rotors = std::stoi(args[0]);
+		const auto messages = loadMessages(args[1]);
+		args = args.subspan(2);
+		const auto options = bombe::cli::parseOptions(args);
+
+		bombe::WheelOrderRules rules(num_rotors);
+		if(const auto it = options.find("rules-file"); it != options.end())
+		{
+			rules.loadRules(it->second);
+		}
+		if(const auto it = options.find("rules"); it != options.end())
+		{
+			rules.parseRules(it->second);
+		}
+		const size_t min_overlap = bombe::cli::optionValue(options, "min-overlap", 20);
+		const size_t margin = bombe::cli::optionValue(options, "margin", 20);
+		const size_t num_threads =
+			bombe::cli::optionValue(options, "threads", std::max<size_t>(std::thread::hardware_concurrency(), 1));
+
+		const auto tic = std::chrono::steady_clock::now();
+		const bombe::Banburismus banburismus(num_rotors, messages);
+		const auto hypotheses = banburismus.rankWheels(rules, min_overlap, num_threads);
+		const auto toc = std::chrono::steady_clock::now();
+		if(hypotheses.empty())
+		{
+			throw std::invalid_argument("No wheel order satisfies the rules");
+		}
+
+		std::cout << "Messages: " << banburismus.numMessages() << '\n';
+		std::cout << "Middle Fast Decibans Depths\n";
+		std::vector<bombe::WheelHypothesis> candidates;
+		for(const auto& hypothesis : hypotheses)
+		{
+			std::cout << std::setw(6) << static_cast<int>(hypothesis.middle_rotor) << std::setw(5)
+					  << static_cast<int>(hypothesis.fast_rotor) << std::setw(9) << std::fixed << std::setprecision(1)
+					  << hypothesis.decibans << std::setw(7) << hypothesis.num_depths << '\n';
+			if(hypothesis.decibans + margin >= hypotheses[0].decibans)
+			{
+				candidates.push_back(hypothesis);
+			}
+		}
+		std::cout << "Rules: " << bombe::slotRules(candidates, num_rotors) << '\n';
+		std::cout << "Banburismus takes " << std::defaultfloat << std::chrono::duration<double>(toc - tic).count()
+		          << " sec\n";
+
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
@@ -0,0 +1,679 @@
+#include "bombe.h"
+#include "cli_tools.h"
+#include "job_queue.h"
+#include "loop_index.h"
+#include "thread_affinity.h"
+#include "wheel_orders.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: bombe_service serve <socket> <threads> [--pin] [--cache=<n>]\n"
+	       "       bombe_service submit <socket> <menufile> [--priority=<n>] [--wheels=<UKW>,<R1>,...] "
+	       "[--rules=<rules>] [--rules-file=<file>] [--positions=<spec>] [--loop-screen]";
+}
+
+// Set by SIGINT/SIGTERM, polled by the accept loop
+std::atomic<bool> g_stopping{false};
+
+extern "C" void onStopSignal(int)
+{
+	g_stopping.store(true);
+}
+
+sockaddr_un socketAddress(const std::string& path)
+{
+	sockaddr_un address{};
+	if(path.size() >= sizeof(address.sun_path))
+	{
+		throw std::invalid_argument("Socket path too long: " + path);
+	}
+	address.sun_family = AF_UNIX;
+	std::copy(path.begin(), path.end(), address.sun_path);
+	return address;
+}
+
+// Whole line or nothing; false once the peer is gone, or has not taken the line within the send timeout. With
+// MSG_DONTWAIT, false unless the line fits into the socket buffer at once.
+bool writeLine(int fd, std::string line, int flags = 0)
+{
+	line += '\n';
+	for(size_t offset = 0; offset < line.size();)
+	{
+		const ssize_t size = send(fd, line.data() + offset, line.size() - offset, flags);
+		if(size <= 0)
+		{
+			return false;
+		}
+		offset += static_cast<size_t>(size);
+	}
+	return true;
+}
+
+class LineReader
+{
+public:
+	explicit LineReader(int fd)
+		: fd_{fd}
+	{
+	}
+
+	// Next line without the line break, or nothing at the end of the stream
+	std::optional<std::string> next()
+	{
+		for(;;)
+		{
+			if(const size_t end = buffer_.find('\n'); end != std::string::npos)
+			{
+				std::string line = buffer_.substr(0, end);
+				buffer_.erase(0, end + 1);
+				if(!line.empty() && (line.back() == '\r'))
+				{
+					line.pop_back();
+				}
+				return line;
+			}
+			std::array<char, 4096> chunk;
+			const ssize_t size = recv(fd_, chunk.data(), chunk.size(), 0);
+			if(size <= 0)
+			{
+				if(buffer_.empty())
+				{
+					return std::nullopt;
+				}
+				return std::exchange(buffer_, std::string());
+			}
+			buffer_.append(chunk.data(), static_cast<size_t>(size));
+		}
+	}
+
+private:
+	int fd_;
+	std::string buffer_;
+};
+
+// One client request: a menu swept over a set of wheel orders. The connection stays open until the last work unit
+// is done, and is closed with the job.
+struct Job : bombe::QueuedJob
+{
+	bool loop_screen;
+	int fd;
+	std::chrono::steady_clock::time_point start_time;
+
+	std::mutex write_mutex;
+	std::atomic<uint64_t> num_stops{0};
+
+	~Job() override
+	{
+		if(num_pending > 0)
+		{
+			// Best effort: a client that stopped reading must not hold up the thread releasing the job
+			writeLine(fd, "error Job cancelled", MSG_DONTWAIT);
+		}
+		close(fd);
+	}
+
+	void reply(const std::string& line)
+	{
+		std::lock_guard lock(write_mutex);
+		if(!cancelled && !writeLine(fd, line))
+		{
+			cancelled = true;
+		}
+	}
+};
+
+// Loop index tables (scrambler maps at every position and loop fixed points) stay resident across jobs, for the
+// most recently used wheel orders
+class LoopIndexCache
+{
+public:
+	struct Entry
+	{
+		std::mutex mutex; // a LoopIndex is not thread-safe
+		std::optional<bombe::LoopIndex> index;
+	};
+
+	explicit LoopIndexCache(size_t capacity)
+		: capacity_{capacity}
+	{
+	}
+
+	std::shared_ptr<Entry> get(const bombe::WheelOrder& wheel_order)
+	{
+		std::lock_guard lock(mutex_);
+		const auto it = std::find_if(
+			entries_.begin(), entries_.end(), [&](const auto& entry) { return entry.first == wheel_order; });
+		if(it != entries_.end())
+		{
+			entries_.splice(entries_.begin(), entries_, it);
+			return it->second;
+		}
+		entries_.emplace_front(wheel_order, std::make_shared<Entry>());
+		if(entries_.size() > capacity_)
+		{
+			entries_.pop_back();
+		}
+		return entries_.front().second;
+	}
+
+private:
+	const size_t capacity_;
+	std::mutex mutex_;
+	std::list<std::pair<bombe::WheelOrder, std::shared_ptr<Entry>>> entries_; // most recently used first
+};
+
+void workerProcessing(bombe::JobQueue& queue, LoopIndexCache& loop_indices, std::optional<size_t> cpu)
+{
+	if(cpu && !bombe::pinCurrentThread(*cpu))
+	{
+		std::cerr << "Cannot pin thread to CPU " << *cpu << "\n";
+	}
+
+	// Reconfigured while consecutive units belong to the same job
+	std::optional<bombe::Bombe> my_bombe;
+	uint64_t bombe_job_id = 0;
+	std::array<char, bombe::MAX_STOP_TEXT_SIZE> text;
+	while(const auto unit = queue.pop())
+	{
+		Job& job = static_cast<Job&>(*unit->job);
+		const auto& [reflector_model, rotor_models] = unit->wheel_order;
+		if(!job.cancelled)
+		{
+			try
+			{
+				if(my_bombe && (bombe_job_id == job.id))
+				{
+					my_bombe->reconfigure(reflector_model, rotor_models);
+				}
+				else
+				{
+					my_bombe.emplace(job.menu, reflector_model, rotor_models);
+					my_bombe->setMonitor(nullptr, &job.cancelled);
+					bombe_job_id = job.id;
+				}
+				my_bombe->setSearchSpace(unit->search_space);
+
+				std::vector<uint32_t> candidates;
+				if(job.loop_screen)
+				{
+					const auto entry = loop_indices.get(unit->wheel_order);
+					std::lock_guard lock(entry->mutex);
+					if(!entry->index)
+					{
+						entry->index.emplace(reflector_model, rotor_models);
+					}
+					candidates = entry->index->candidates(job.menu);
+				}
+				const auto& stops = job.loop_screen ? my_bombe->runPositions(candidates) : my_bombe->run();
+				for(const auto& stop : stops)
+				{
+					job.reply("stop " + std::string(text.data(), bombe::formatStopText(stop, text)));
+				}
+				job.num_stops += stops.size();
+			}
+			catch(const std::exception& e)
+			{
+				job.reply(std::string("error ") + e.what());
+				job.cancelled = true;
+				my_bombe.reset();
+			}
+		}
+
+		if((--job.num_pending == 0) && !job.cancelled)
+		{
+			const double seconds =
+				std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start_time).count();
+			std::ostringstream oss;
+			oss << "done " << job.num_stops << " stops " << std::fixed << std::setprecision(3) << seconds << " sec";
+			job.reply(oss.str());
+		}
+	}
+}
+
+// Jobs whose clients are still connected. A client that hangs up cancels its job, so that an abandoned sweep does
+// not keep the workers busy.
+class ConnectionWatch
+{
+public:
+	void add(const std::shared_ptr<Job>& job)
+	{
+		std::lock_guard lock(mutex_);
+		jobs_.push_back(job);
+	}
+
+	// Without blocking; called from the accept loop
+	void cancelDisconnected()
+	{
+		std::vector<std::shared_ptr<Job>> jobs;
+		{
+			std::lock_guard lock(mutex_);
+			std::erase_if(jobs_, [](const auto& job) { return job.expired(); });
+			for(const auto& weak_job : jobs_)
+			{
+				if(auto job = weak_job.lock())
+				{
+					jobs.push_back(std::move(job));
+				}
+			}
+		}
+		std::vector<pollfd> poll_fds;
+		for(const auto& job : jobs)
+		{
+			poll_fds.push_back({job->fd, POLLIN, 0});
+		}
+		if(poll(poll_fds.data(), poll_fds.size(), 0) <= 0)
+		{
+			return;
+		}
+		for(size_t job_idx = 0; job_idx < jobs.size(); ++job_idx)
+		{
+			// The request has been read, so a readable connection without data is one the client has closed
+			const short events = poll_fds[job_idx].revents;
+			char byte;
+			if((events & (POLLHUP | POLLERR)) ||
+			   ((events & POLLIN) && (recv(poll_fds[job_idx].fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0)))
+			{
+				jobs[job_idx]->cancelled = true;
+			}
+		}
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<std::weak_ptr<Job>> jobs_;
+};
+
+// Request handler threads. They are joined before the job queue goes away; a handler still reading its request at
+// shutdown is woken by shutting down its connection for reading.
+class ConnectionHandlers
+{
+public:
+	template<typename Function>
+	void start(uint64_t job_id, int fd, Function function)
+	{
+		std::lock_guard lock(mutex_);
+		joinFinished();
+		auto& handler = handlers_[job_id];
+		handler.fd = fd;
+		handler.thread = std::thread([this, job_id, function = std::move(function)]() {
+			function();
+			std::lock_guard finish_lock(mutex_);
+			if(const auto it = handlers_.find(job_id); it != handlers_.end())
+			{
+				it->second.finished = true;
+			}
+		});
+	}
+
+	// From now on the handler's connection may be closed at any time, so stop() leaves it alone
+	void finishReading(uint64_t job_id)
+	{
+		std::lock_guard lock(mutex_);
+		if(const auto it = handlers_.find(job_id); it != handlers_.end())
+		{
+			it->second.reading = false;
+		}
+	}
+
+	void stop()
+	{
+		std::map<uint64_t, Handler> handlers;
+		{
+			std::lock_guard lock(mutex_);
+			for(const auto& [job_id, handler] : handlers_)
+			{
+				if(handler.reading)
+				{
+					shutdown(handler.fd, SHUT_RD);
+				}
+			}
+			handlers.swap(handlers_);
+		}
+		for(auto& [job_id, handler] : handlers)
+		{
+			handler.thread.join();
+		}
+	}
+
+private:
+	struct Handler
+	{
+		std::thread thread;
+		int fd{-1};
+		bool reading{true};
+		bool finished{false};
+	};
+
+	// With the mutex held
+	void joinFinished()
+	{
+		for(auto it = handlers_.begin(); it != handlers_.end();)
+		{
+			if(it->second.finished)
+			{
+				it->second.thread.join();
+				it = handlers_.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	std::mutex mutex_;
+	std::map<uint64_t, Handler> handlers_;
+};
+
+// Request: "--name[=value]" option lines, then the menu lines up to the terminator line ("+++++")
+void handleConnection(
+	int fd, uint64_t job_id, bombe::JobQueue& queue, ConnectionHandlers& handlers, ConnectionWatch& watch)
+{
+	auto job = std::make_shared<Job>();
+	job->id = job_id;
+	job->fd = fd;
+	job->start_time = std::chrono::steady_clock::now();
+
+	// The whole request is read first, so that only this loop can be woken by ConnectionHandlers::stop()
+	LineReader reader(fd);
+	std::vector<std::string> option_lines;
+	std::vector<std::string> menu_lines;
+	bool complete = false;
+	for(auto line = reader.next(); line; line = reader.next())
+	{
+		if(line->starts_with("--"))
+		{
+			option_lines.push_back(std::move(*line));
+			continue;
+		}
+		if(line->starts_with("+"))
+		{
+			complete = true;
+			break;
+		}
+		menu_lines.push_back(std::move(*line));
+	}
+	handlers.finishReading(job_id);
+
+	try
+	{
+		if(!complete)
+		{
+			throw std::invalid_argument("Request ends before the menu terminator line");
+		}
+
+		std::vector<const char*> option_args;
+		for(const auto& line : option_lines)
+		{
+			option_args.push_back(line.c_str());
+		}
+		std::span<const char* const> args(option_args);
+		const auto options = bombe::cli::parseOptions(args);
+
+		job->menu = bombe::Bombe::loadMenu(menu_lines);
+		const size_t num_rotors = job->menu.numRotors();
+		job->priority = static_cast<int>(std::stol(options.contains("priority") ? options.at("priority") : "0"));
+		job->search_space = bombe::cli::searchSpaceOption(options, num_rotors);
+		if(job->search_space.size(num_rotors) == 0)
+		{
+			throw std::invalid_argument("Empty search space");
+		}
+		job->loop_screen = options.contains("loop-screen") && !bombe::findRegisterLoops(job->menu).empty();
+
+		std::vector<bombe::WheelOrder> wheel_orders;
+		if(const auto it = options.find("wheels"); it != options.end())
+		{
+			// A single wheel order: reflector and rotor numbers as on the command line
+			std::vector<size_t> numbers;
+			std::istringstream iss(it->second);
+			for(std::string token; std::getline(iss, token, ',');)
+			{
+				numbers.push_back(std::stoull(token));
+			}
+			if(numbers.size() != num_rotors + 1)
+			{
+				throw std::invalid_argument("Wrong number of wheels: " + it->second);
+			}
+			auto& wheel_order = wheel_orders.emplace_back();
+			wheel_order.first = bombe::getReflectorModel(num_rotors == 4, numbers[0]);
+			for(size_t k = 0; k < num_rotors; ++k)
+			{
+				wheel_order.second.push_back(bombe::getRotorModel((num_rotors == 4) && (k == 0), numbers[k + 1]));
+			}
+		}
+		else
+		{
+			bombe::WheelOrderRules rules(num_rotors);
+			if(const auto rules_it = options.find("rules"); rules_it != options.end())
+			{
+				rules.parseRules(rules_it->second);
+			}
+			wheel_orders = bombe::enumerateWheelOrders(rules);
+		}
+		if(wheel_orders.empty())
+		{
+			throw std::invalid_argument("No wheel order satisfies the rules");
+		}
+
+		job->reply("accepted " + std::to_string(wheel_orders.size()) + " wheel orders");
+		watch.add(job);
+		queue.push(job, wheel_orders);
+	}
+	catch(const std::exception& e)
+	{
+		job->reply(std::string("error ") + e.what());
+	}
+}
+
+int serve(std::span<const char* const> args)
+{
+	if(args.size() < 2)
+	{
+		throw std::invalid_argument("Cannot parse socket path and number of threads");
+	}
+	const std::string socket_path(args[0]);
+	const size_t num_threads = std::stoi(args[1]);
+	args = args.subspan(2);
+	const auto options = bombe::cli::parseOptions(args);
+
+	const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	const sockaddr_un address = socketAddress(socket_path);
+	unlink(socket_path.c_str());
+	if((listen_fd < 0) || (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) ||
+	   (listen(listen_fd, SOMAXCONN) != 0))
+	{
+		throw std::invalid_argument("Cannot listen on " + socket_path);
+	}
+
+	std::signal(SIGINT, onStopSignal);
+	std::signal(SIGTERM, onStopSignal);
+	std::signal(SIGPIPE, SIG_IGN); // a closed connection fails its write instead
+
+	// The workers start once and stay for all jobs
+	bombe::JobQueue queue;
+	ConnectionHandlers handlers;
+	ConnectionWatch watch;
+	LoopIndexCache loop_indices(bombe::cli::optionValue(options, "cache", 64));
+	std::vector<size_t> cpus;
+	if(options.contains("pin"))
+	{
+		cpus = bombe::availableCpus();
+	}
+	std::vector<std::thread> workers;
+	for(size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+	{
+		std::optional<size_t> cpu;
+		if(!cpus.empty())
+		{
+			cpu = cpus[thread_idx % cpus.size()];
+		}
+		workers.emplace_back(workerProcessing, std::ref(queue), std::ref(loop_indices), cpu);
+	}
+	std::cout << "Serving on " << socket_path << " with " << num_threads << " threads" << std::endl;
+
+	uint64_t num_jobs = 0;
+	while(!g_stopping)
+	{
+		watch.cancelDisconnected();
+		pollfd poll_fd{listen_fd, POLLIN, 0};
+		if(poll(&poll_fd, 1, 200) <= 0)
+		{
+			continue;
+		}
+		const int fd = accept(listen_fd, nullptr, nullptr);
+		if(fd < 0)
+		{
+			continue;
+		}
+		// A client that never finishes its request, or stops reading the replies, must not hold a thread forever. A
+		// reply that times out cancels the job (see Job::reply()).
+		const timeval timeout{30, 0};
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		++num_jobs;
+		handlers.start(num_jobs, fd, [fd, num_jobs, &queue, &handlers, &watch]() {
+			handleConnection(fd, num_jobs, queue, handlers, watch);
+		});
+	}
+
+	// No request handler may push to the queue once it is closed
+	handlers.stop();
+	std::cout << "Stopping, " << queue.size() << " queued work units dropped" << std::endl;
+	queue.close();
+	for(auto& worker : workers)
+	{
+		worker.join();
+	}
+	close(listen_fd);
+	unlink(socket_path.c_str());
+	return 0;
+}
+
+// Send the options and menu file, then print the stops as they arrive
+int submit(std::span<const char* const> args)
+{
+	if(args.size() < 2)
+	{
+		throw std::invalid_argument("Cannot parse socket path and menu file");
+	}
+	const std::string socket_path(args[0]);
+	const std::string menu_filename(args[1]);
+	args = args.subspan(2);
+	auto options = bombe::cli::parseOptions(args);
+
+	// Rules files are read here and sent as one line
+	if(const auto it = options.find("rules-file"); it != options.end())
+	{
+		std::ifstream ifs(it->second);
+		if(!ifs.is_open())
+		{
+			throw std::invalid_argument("Cannot open the wheel order rules file " + it->second);
+		}
+		std::string rules = options.contains("rules") ? options.at("rules") : "";
+		for(std::string line; std::getline(ifs, line);)
+		{
+			rules += (rules.empty() ? "" : ";") + line;
+		}
+		options["rules"] = rules;
+		options.erase("rules-file");
+	}
+
+	std::ifstream ifs(menu_filename);
+	if(!ifs.is_open())
+	{
+		throw std::invalid_argument("Cannot open the menu file " + menu_filename);
+	}
+
+	std::signal(SIGPIPE, SIG_IGN); // a closed connection fails its write instead
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	const sockaddr_un address = socketAddress(socket_path);
+	if((fd < 0) || (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0))
+	{
+		throw std::invalid_argument("Cannot connect to " + socket_path);
+	}
+
+	bool sent = true;
+	for(const auto& [name, value] : options)
+	{
+		sent &= writeLine(fd, "--" + name + (value.empty() ? "" : "=" + value));
+	}
+	for(std::string line; std::getline(ifs, line);)
+	{
+		sent &= writeLine(fd, line);
+	}
+	sent &= writeLine(fd, "+++++"); // in case the file has no terminator line
+	if(!sent)
+	{
+		throw std::invalid_argument("Cannot send the request to " + socket_path);
+	}
+
+	int result = 1;
+	LineReader reader(fd);
+	while(const auto line = reader.next())
+	{
+		if(line->starts_with("stop "))
+		{
+			std::cout << line->substr(5) << '\n';
+		}
+		else if(line->starts_with("error "))
+		{
+			std::cerr << line->substr(6) << '\n';
+		}
+		else
+		{
+			std::cout << *line << std::endl;
+			result = line->starts_with("done ") ? 0 : result;
+		}
+	}
+	close(fd);
+	return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		if(args.empty())
+		{
+			throw std::invalid_argument("Missing mode");
+		}
+		const std::string_view mode(args[0]);
+		if(mode == "serve")
+		{
+			return serve(args.subspan(1));
+		}
+		if(mode == "submit")
+		{
+			return submit(args.subspan(1));
+		}
+		throw std::invalid_argument("Unknown mode " + std::string(mode));
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
@@ -0,0 +1,140 @@
+#include "cli_tools.h"
+#include "loop_index.h"
+#include "workload.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: bombe_soak [--rotors=<3|4>] [--lengths=<n,...>] [--loops=<n,...>] [--crib=<n>] [--count=<n>] "
+	       "[--seed=<n>] [--corpus=<file>] [--loop-screen] [--menus=<dir>]";
+}
+
+// Comma separated numbers, e.g. "8,12,16"
+std::vector<size_t> optionList(const bombe::cli::Options& options, std::string_view name, size_t default_value)
+{
+	const auto it = options.find(name);
+	if(it == options.end())
+	{
+		return {default_value};
+	}
+	std::vector<size_t> values;
+	std::istringstream iss(it->second);
+	for(std::string token; std::getline(iss, token, ',');)
+	{
+		values.push_back(std::stoull(token));
+	}
+	return values;
+}
+
+std::string formatStop(const bombe::Stop& stop)
+{
+	std::array<char, bombe::MAX_STOP_TEXT_SIZE> text;
+	return std::string(text.data(), bombe::formatStopText(stop, text));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		const auto options = bombe::cli::parseOptions(args);
+
+		bombe::WorkloadSpec spec;
+		spec.num_rotors = bombe::cli::optionValue(options, "rotors", 3);
+		spec.crib_length = bombe::cli::optionValue(options, "crib", spec.crib_length);
+		const auto menu_lengths = optionList(options, "lengths", spec.menu_length);
+		const auto loop_counts = optionList(options, "loops", spec.num_loops);
+		const size_t count = bombe::cli::optionValue(options, "count", 10);
+		const bool loop_screen = options.contains("loop-screen");
+
+		std::string corpus;
+		if(const auto it = options.find("corpus"); it != options.end())
+		{
+			std::ifstream ifs(it->second);
+			if(!ifs.is_open())
+			{
+				throw std::invalid_argument("Cannot open the corpus file " + it->second);
+			}
+			corpus.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		}
+		bombe::WorkloadGenerator generator(bombe::cli::optionValue(options, "seed", 1), corpus);
+
+		const auto menus_it = options.find("menus");
+		if(menus_it != options.end())
+		{
+			std::filesystem::create_directories(menus_it->second);
+		}
+
+		size_t num_failures = 0;
+		size_t workload_idx = 0;
+		for(const size_t menu_length : menu_lengths)
+		{
+			for(const size_t num_loops : loop_counts)
+			{
+				spec.menu_length = menu_length;
+				spec.num_loops = num_loops;
+				uint64_t total_stops = 0;
+				double total_seconds = 0;
+				size_t config_failures = 0;
+				for(size_t k = 0; k < count; ++k, ++workload_idx)
+				{
+					const auto workload = generator.generate(spec);
+					if(menus_it != options.end())
+					{
+						std::ofstream ofs(menus_it->second + "/workload_" + std::to_string(workload_idx) + ".txt");
+						for(const auto& line : bombe::formatMenu(workload.menu))
+						{
+							ofs << line << '\n';
+						}
+						// After the terminator line, so menu readers skip it
+						ofs << "# " << formatStop(workload.expected_stop) << " ring " << workload.ringstellung
+							<< " grun " << workload.grundstellung << " steckers " << workload.steckers << '\n';
+					}
+
+					const auto tic = std::chrono::steady_clock::now();
+					bombe::Bombe my_bombe(workload.menu, workload.reflector_model, workload.rotor_models);
+					const bool use_screen = loop_screen && !bombe::findRegisterLoops(workload.menu).empty();
+					std::vector<uint32_t> candidates;
+					if(use_screen)
+					{
+						bombe::LoopIndex loop_index(workload.reflector_model, workload.rotor_models);
+						candidates = loop_index.candidates(workload.menu);
+					}
+					const auto& stops = use_screen ? my_bombe.runPositions(candidates) : my_bombe.run();
+					const double seconds =
+						std::chrono::duration<double>(std::chrono::steady_clock::now() - tic).count();
+
+					const bool found = bombe::containsStop(stops, workload.expected_stop);
+					config_failures += found ? 0 : 1;
+					total_stops += stops.size();
+					total_seconds += seconds;
+					std::cout << "#" << workload_idx << ' ' << formatStop(workload.expected_stop) << "  ring "
+							  << workload.ringstellung << "  stops " << stops.size() << "  " << std::fixed
+							  << std::setprecision(3) << seconds << " sec  " << (found ? "OK" : "MISSING") << '\n';
+				}
+
+				const double positions = static_cast<double>(bombe::numPositions(spec.num_rotors)) * count;
+				std::cout << "Menu length " << menu_length << ", " << num_loops << " loops: " << count
+						  << " workloads, " << std::setprecision(1) << double(total_stops) / count
+						  << " stops per run, " << positions / total_seconds / 1e6 << " M positions/sec, "
+						  << config_failures << " missing\n";
+				num_failures += config_failures;
+			}
+		}
+
+		return (num_failures == 0) ? 0 : 1;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
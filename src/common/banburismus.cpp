@@ -0,0 +1,268 @@
+#include "banburismus.h"
+#include "ring_recovery.h"
+#include "stepping.h"
+#include "stop.h"
+
+#include <bit>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+namespace bombe {
+
+namespace {
+
+constexpr uint32_t NO_MESSAGE = UINT32_MAX;
+
+// Integer sums, so that scores do not depend on the thread count
+struct DepthCounts
+{
+	uint64_t num_repeats{0};
+	uint64_t num_letters{0};
+	uint64_t num_depths{0};
+};
+
+// 64 bits of a bit plane from the given bit on (planes carry a spare zero word at the end)
+uint64_t bitsAt(const std::vector<uint64_t>& plane, size_t bit)
+{
+	const size_t word = bit / 64;
+	const size_t shift = bit % 64;
+	const uint64_t low = plane[word] >> shift;
+	return (shift == 0) ? low : (low | (plane[word + 1] << (64 - shift)));
+}
+
+} // anonymous namespace
+
+Banburismus::Banburismus(size_t num_rotors, std::span<const BanburismusMessage> messages)
+	: num_rotors_{num_rotors}
+{
+	if((num_rotors != 3) && (num_rotors != 4))
+	{
+		throw std::invalid_argument("Banburismus needs 3 or 4 rotors");
+	}
+
+	for(const auto& message : messages)
+	{
+		if(message.indicator.size() != num_rotors)
+		{
+			throw std::invalid_argument("Invalid message setting " + message.indicator);
+		}
+
+		Message& packed = messages_.emplace_back();
+		packed.setting.fill(0);
+		char2Letter(message.indicator, std::span(packed.setting).first(num_rotors));
+		packed.size = message.ciphertext.size();
+		for(auto& plane : packed.planes)
+		{
+			plane.assign(packed.size / 64 + 2, 0);
+		}
+		for(size_t k = 0; k < packed.size; ++k)
+		{
+			const Letter letter = char2Letter(message.ciphertext[k]);
+			for(size_t b = 0; b < packed.planes.size(); ++b)
+			{
+				packed.planes[b][k / 64] |= uint64_t((letter >> b) & 1) << (k % 64);
+			}
+		}
+	}
+
+	// A repeat is as likely as two letters of German plaintext matching when in depth, and 1/26 otherwise
+	double depth_repeat = 0;
+	for(const double log_probability : germanLogProbabilities())
+	{
+		depth_repeat += std::exp(2 * log_probability);
+	}
+	double total = 0;
+	for(const double log_probability : germanLogProbabilities())
+	{
+		total += std::exp(log_probability);
+	}
+	depth_repeat /= total * total;
+	repeat_decibans_ = 10 * std::log10(depth_repeat * NUM_LETTERS);
+	blank_decibans_ = 10 * std::log10((1 - depth_repeat) * NUM_LETTERS / (NUM_LETTERS - 1));
+}
+
+size_t Banburismus::countRepeats(size_t message1, size_t message2, size_t offset) const
+{
+	const Message& m1 = messages_[message1];
+	const Message& m2 = messages_[message2];
+	if(offset >= m1.size)
+	{
+		return 0;
+	}
+
+	// Bit-sliced comparison: 64 letters per word, equal where all 5 bit planes agree
+	const size_t overlap = std::min(m1.size - offset, m2.size);
+	size_t num_repeats = 0;
+	for(size_t bit = 0; bit < overlap; bit += 64)
+	{
+		uint64_t diff = 0;
+		for(size_t b = 0; b < m1.planes.size(); ++b)
+		{
+			diff |= bitsAt(m1.planes[b], offset + bit) ^ m2.planes[b][bit / 64];
+		}
+		uint64_t same = ~diff;
+		if(overlap - bit < 64)
+		{
+			same &= (uint64_t(1) << (overlap - bit)) - 1;
+		}
+		num_repeats += std::popcount(same);
+	}
+	return num_repeats;
+}
+
+std::vector<WheelHypothesis> Banburismus::rankWheels(const WheelOrderRules& rules,
+                                                     size_t min_overlap,
+                                                     size_t num_threads) const
+{
+	if(rules.num_rotors != num_rotors_)
+	{
+		throw std::invalid_argument("Wheel order rules do not match the number of rotors");
+	}
+
+	std::vector<WheelHypothesis> hypotheses;
+	for(const auto& [reflector_model, rotor_models] : enumerateWheelOrders(rules))
+	{
+		const RotorModel middle = rotor_models[num_rotors_ - 2];
+		const RotorModel fast = rotor_models[num_rotors_ - 1];
+		const bool is_new = std::none_of(hypotheses.begin(), hypotheses.end(), [&](const auto& hypothesis) {
+			return (hypothesis.middle_rotor == middle) && (hypothesis.fast_rotor == fast);
+		});
+		if(is_new)
+		{
+			hypotheses.push_back({middle, fast, 0, 0});
+		}
+	}
+
+	// Messages by message setting, as linked lists
+	std::vector<uint32_t> first_message(numPositions(num_rotors_), NO_MESSAGE);
+	std::vector<uint32_t> next_message(messages_.size(), NO_MESSAGE);
+	for(size_t k = messages_.size(); k-- > 0;)
+	{
+		const uint32_t position_index = encodePositions(std::span(messages_[k].setting).first(num_rotors_));
+		next_message[k] = first_message[position_index];
+		first_message[position_index] = static_cast<uint32_t>(k);
+	}
+
+	// Turnovers are on the display, so stepping is followed in display letters (ring A)
+	std::vector<std::pair<std::bitset<NUM_LETTERS>, std::bitset<NUM_LETTERS>>> turnovers;
+	for(const auto& hypothesis : hypotheses)
+	{
+		turnovers.emplace_back(Rotor(hypothesis.middle_rotor).turnovers(), Rotor(hypothesis.fast_rotor).turnovers());
+	}
+
+	num_threads = std::max<size_t>(num_threads, 1);
+	std::vector<std::vector<DepthCounts>> thread_counts(num_threads, std::vector<DepthCounts>(hypotheses.size()));
+	const auto worker = [&](size_t thread_idx) {
+		auto& counts = thread_counts[thread_idx];
+		const size_t slow_idx = num_rotors_ - 3;
+		for(size_t message1 = thread_idx; message1 < messages_.size(); message1 += num_threads)
+		{
+			const Message& m1 = messages_[message1];
+			if(m1.size < min_overlap)
+			{
+				continue;
+			}
+			auto setting = m1.setting;
+			for(size_t h = 0; h < hypotheses.size(); ++h)
+			{
+				const SteppingSchedule schedule(
+					{m1.setting[slow_idx], m1.setting[slow_idx + 1], m1.setting[slow_idx + 2]},
+					turnovers[h].first,
+					turnovers[h].second);
+
+				// Message 2 is in depth at this offset when message 1 steps into its setting
+				for(size_t offset = 0; offset + min_overlap <= m1.size; ++offset)
+				{
+					const auto positions = schedule.positionsAfter(offset);
+					std::copy(positions.begin(), positions.end(), setting.begin() + slow_idx);
+					const uint32_t position_index = encodePositions(std::span(setting).first(num_rotors_));
+					for(uint32_t message2 = first_message[position_index]; message2 != NO_MESSAGE;
+					    message2 = next_message[message2])
+					{
+						// Same settings: count the pair once
+						if((offset == 0) && (message2 <= message1))
+						{
+							continue;
+						}
+						if(messages_[message2].size < min_overlap)
+						{
+							continue;
+						}
+						counts[h].num_repeats += countRepeats(message1, message2, offset);
+						counts[h].num_letters += std::min(m1.size - offset, messages_[message2].size);
+						++counts[h].num_depths;
+					}
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+	{
+		threads.emplace_back(worker, thread_idx);
+	}
+	worker(0);
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	for(size_t h = 0; h < hypotheses.size(); ++h)
+	{
+		DepthCounts total;
+		for(const auto& counts : thread_counts)
+		{
+			total.num_repeats += counts[h].num_repeats;
+			total.num_letters += counts[h].num_letters;
+			total.num_depths += counts[h].num_depths;
+		}
+		hypotheses[h].decibans =
+			total.num_repeats * repeat_decibans_ + (total.num_letters - total.num_repeats) * blank_decibans_;
+		hypotheses[h].num_depths = total.num_depths;
+	}
+	std::stable_sort(hypotheses.begin(), hypotheses.end(), [](const auto& h1, const auto& h2) {
+		return h1.decibans > h2.decibans;
+	});
+	return hypotheses;
+}
+
+std::string slotRules(std::span<const WheelHypothesis> hypotheses, size_t num_rotors)
+{
+	if(hypotheses.empty())
+	{
+		throw std::invalid_argument("No wheel hypothesis for slot rules");
+	}
+
+	std::vector<RotorModel> middle_rotors;
+	std::vector<RotorModel> fast_rotors;
+	for(const auto& hypothesis : hypotheses)
+	{
+		if(std::find(middle_rotors.begin(), middle_rotors.end(), hypothesis.middle_rotor) == middle_rotors.end())
+		{
+			middle_rotors.push_back(hypothesis.middle_rotor);
+		}
+		if(std::find(fast_rotors.begin(), fast_rotors.end(), hypothesis.fast_rotor) == fast_rotors.end())
+		{
+			fast_rotors.push_back(hypothesis.fast_rotor);
+		}
+	}
+	std::sort(middle_rotors.begin(), middle_rotors.end());
+	std::sort(fast_rotors.begin(), fast_rotors.end());
+
+	std::ostringstream oss;
+	oss << "slot " << num_rotors - 1;
+	for(const auto model : middle_rotors)
+	{
+		oss << ' ' << static_cast<int>(model);
+	}
+	oss << "; slot " << num_rotors;
+	for(const auto model : fast_rotors)
+	{
+		oss << ' ' << static_cast<int>(model);
+	}
+	return oss.str();
+}
+
+} // namespace bombe
@@ -0,0 +1,68 @@
+#ifndef BOMBE_BANBURISMUS_H
+#define BOMBE_BANBURISMUS_H
+
+#include "wheel_orders.h"
+
+#include <string>
+
+namespace bombe {
+
+// A message of the day's traffic: its message setting (rotor display, left to right) and ciphertext
+struct BanburismusMessage
+{
+	std::string indicator;
+	std::string ciphertext;
+};
+
+// Evidence for one middle/fast rotor pair
+struct WheelHypothesis
+{
+	RotorModel middle_rotor;
+	RotorModel fast_rotor;
+	double decibans;   // summed score of the message pairs this hypothesis puts in depth
+	size_t num_depths; // number of such pairs
+};
+
+// Banburismus: messages under the same daily key are in depth when one steps into the other's message setting, which
+// depends on the turnover letters of the middle and fast rotors (ring settings do not matter, as turnovers are on the
+// display). Every middle/fast pair is scored by the repeats of the pairs it puts in depth; wrong pairs put other
+// messages in depth, whose repeats are those of unrelated ciphertexts.
+class Banburismus
+{
+public:
+	Banburismus(size_t num_rotors, std::span<const BanburismusMessage> messages);
+
+	size_t numMessages() const
+	{
+		return messages_.size();
+	}
+
+	// Positions where the letter at offset + k of message 1 equals the letter at k of message 2
+	size_t countRepeats(size_t message1, size_t message2, size_t offset) const;
+
+	// Middle/fast pairs of the admissible wheel orders, best first. Pairs overlapping by fewer than min_overlap
+	// letters are ignored.
+	std::vector<WheelHypothesis> rankWheels(const WheelOrderRules& rules, size_t min_overlap, size_t num_threads) const;
+
+private:
+	struct Message
+	{
+		std::array<Letter, MAX_ROTORS> setting;
+		size_t size;
+		std::array<std::vector<uint64_t>, 5> planes; // bit b of letter k is bit k of planes[b]
+	};
+
+private:
+	size_t num_rotors_;
+	std::vector<Message> messages_;
+	double repeat_decibans_;
+	double blank_decibans_;
+};
+
+// Rules restricting the middle and fast slots to the rotors of the given hypotheses, e.g. "slot 2 1 4; slot 3 2",
+// for WheelOrderRules::parseRules()
+std::string slotRules(std::span<const WheelHypothesis> hypotheses, size_t num_rotors);
+
+} // namespace bombe
+
+#endif // BOMBE_BANBURISMUS_H
@@ -0,0 +1,20 @@
+#include "bit_matrix.h"
+
+namespace bombe {
+
+void transpose(BitMatrix& matrix)
+{
+	// Swap the off-diagonal blocks of size 16, then 8, 4, 2 and 1
+	uint32_t mask = 0x0000FFFF;
+	for(uint32_t width = 16; width != 0; width >>= 1, mask ^= (mask << width))
+	{
+		for(uint32_t row = 0; row < 32; row = ((row | width) + 1) & ~width)
+		{
+			const uint32_t t = ((matrix[row] >> width) ^ matrix[row | width]) & mask;
+			matrix[row] ^= t << width;
+			matrix[row | width] ^= t;
+		}
+	}
+}
+
+} // namespace bombe
@@ -0,0 +1,19 @@
+#ifndef BOMBE_BIT_MATRIX_H
+#define BOMBE_BIT_MATRIX_H
+
+#include <array>
+#include <cstdint>
+
+namespace bombe {
+
+// 32x32 bit matrix: bit c of row r is element (r, c)
+struct alignas(64) BitMatrix : std::array<uint32_t, 32>
+{
+};
+
+// In-place transpose by recursive block swaps (5 rounds of 16 independent row operations)
+void transpose(BitMatrix& matrix);
+
+} // namespace bombe
+
+#endif // BOMBE_BIT_MATRIX_H
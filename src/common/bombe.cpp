@@ -1,5 +1,10 @@
 #include "bombe.h"
 
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <limits>
+
 namespace bombe {
 
 Bombe::Menu Bombe::loadMenu(std::span<const std::string> lines)
@@ -50,13 +55,18 @@ Bombe::Menu Bombe::loadMenu(std::span<const std::string> lines)
 Bombe::Bombe(const Menu& menu, ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
 	: menu_{menu}
 	, reflector_model_{reflector_model}
-	, rotor_models_{rotor_models.begin(), rotor_models.end()}
+	, wheel_order_{encodeWheelOrder(rotor_models)}
 {
-	// Create scramblers
+	// Edges at the same slow/middle rotor positions share one scrambler for the reflector and left rotors; each edge
+	// only has its own fast rotor on top
 	const size_t num_edges = menu.edges.size();
 	const size_t num_rotors = rotor_models.size();
-	scramblers_.reserve(num_edges);
+	const size_t fast_idx = num_rotors - 1;
+	fast_rotors_.reserve(num_edges);
+	edge_groups_.resize(num_edges);
 	scrambler_maps_.resize(num_edges);
+	edge_stamps_.resize(num_edges);
+	edge_activities_.resize(num_edges);
 	for(size_t edge_idx = 0; edge_idx < num_edges; ++edge_idx)
 	{
 		const auto& edge = menu.edges[edge_idx];
@@ -65,85 +75,342 @@ Bombe::Bombe(const Menu& menu, ReflectorModel reflector_model, std::span<const R
 			throw std::invalid_argument("Invalid bombe menu");
 		}
 
-		scramblers_.emplace_back(reflector_model, rotor_models);
-		for(size_t k = 0; k < num_rotors; ++k)
+		const uint32_t group_idx = groupOf(edge.rotor_positions, rotor_models);
+		edge_groups_[edge_idx] = group_idx;
+		auto& fast_rotor = fast_rotors_.emplace_back(rotor_models[fast_idx]);
+		fast_rotor.setPosition(edge.rotor_positions[fast_idx], group_scramblers_[group_idx].rotor(fast_idx - 1));
+
+		scrambler_maps_[edge_idx].nodes = edge.nodes;
+		scrambler_maps_[edge_idx].edge_idx = static_cast<uint32_t>(edge_idx);
+		const Letter first_position = menu.edges[0].rotor_positions[fast_idx];
+		edge_crib_offsets_.push_back(
+			static_cast<Letter>((edge.rotor_positions[fast_idx] + NUM_LETTERS - first_position) % NUM_LETTERS));
+	}
+	num_menu_groups_ = group_scramblers_.size();
+
+	computeRegisterDistances();
+	setSearchSpace(SearchSpace());
+	setTurnoverHypotheses({});
+}
+
+void Bombe::reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
+{
+	const size_t num_rotors = rotor_models.size();
+	if(num_rotors != menu_.numRotors())
+	{
+		throw std::invalid_argument("Rotor models do not match the bombe menu");
+	}
+
+	reflector_model_ = reflector_model;
+	wheel_order_ = encodeWheelOrder(rotor_models);
+	const size_t fast_idx = num_rotors - 1;
+	for(size_t group_idx = 0; group_idx < group_scramblers_.size(); ++group_idx)
+	{
+		auto& group_scrambler = group_scramblers_[group_idx];
+		group_scrambler.reconfigure(reflector_model, rotor_models);
+		for(size_t k = 0; k < fast_idx; ++k)
+		{
+			group_scrambler.setRotorPosition(k, group_positions_[group_idx][k]);
+		}
+	}
+	for(size_t edge_idx = 0; edge_idx < fast_rotors_.size(); ++edge_idx)
+	{
+		fast_rotors_[edge_idx] = Rotor(rotor_models[fast_idx]);
+		fast_rotors_[edge_idx].setPosition(menu_.edges[edge_idx].rotor_positions[fast_idx],
+		                                   group_scramblers_[edge_groups_[edge_idx]].rotor(fast_idx - 1));
+	}
+	for(size_t stepped_idx = 0; stepped_idx < stepped_rotors_.size(); ++stepped_idx)
+	{
+		stepped_rotors_[stepped_idx] = Rotor(rotor_models[fast_idx]);
+		stepped_rotors_[stepped_idx].setPosition(menu_.edges[stepped_edges_[stepped_idx]].rotor_positions[fast_idx],
+		                                         group_scramblers_[stepped_groups_[stepped_idx]].rotor(fast_idx - 1));
+	}
+}
+
+void Bombe::setTurnoverHypotheses(const std::bitset<NUM_LETTERS>& turnover_positions)
+{
+	const size_t num_rotors = menu_.numRotors();
+	const size_t fast_idx = num_rotors - 1;
+	const Letter first_position = menu_.edges[0].rotor_positions[fast_idx];
+	if(turnover_positions.test(first_position))
+	{
+		throw std::invalid_argument("A turnover at the first menu edge steps the whole menu, which the search covers");
+	}
+	if(turnover_positions.any())
+	{
+		// Crib offsets count from the first edge and assume the middle rotor stands still across the menu as written
+		if(num_menu_groups_ > 1)
+		{
+			throw std::invalid_argument("Turnover hypotheses need a menu without a middle rotor step");
+		}
+		// The crib may wrap from Z to A, so it starts after the largest gap between the fast rotor positions, which
+		// must be the one before the first edge
+		std::vector<Letter> offsets = edge_crib_offsets_;
+		std::sort(offsets.begin(), offsets.end());
+		const Letter gap_before_first = NUM_LETTERS - offsets.back();
+		for(size_t k = 1; k < offsets.size(); ++k)
 		{
-			scramblers_.back().setRotorPosition(k, edge.rotor_positions[k]);
+			if(offsets[k] - offsets[k - 1] > gap_before_first)
+			{
+				throw std::invalid_argument(
+					"Turnover hypotheses need the first menu edge at the earliest crib position");
+			}
 		}
+	}
 
-		scrambler_maps_[edge_idx].nodes = edge.nodes;
+	// Hypotheses in crib order, after the menu as written
+	turnover_offsets_.assign(1, NUM_LETTERS);
+	for(Letter offset = 1; offset < NUM_LETTERS; ++offset)
+	{
+		if(turnover_positions.test((first_position + offset) % NUM_LETTERS))
+		{
+			turnover_offsets_.push_back(offset);
+		}
 	}
+
+	// Edges stepped by any hypothesis get a second fast rotor on the group with the middle rotor one step on. Groups
+	// are shared as usual, including with the groups of the menu as written.
+	std::array<RotorModel, MAX_ROTORS> rotor_models;
+	decodeWheelOrder(wheel_order_, std::span(rotor_models).first(num_rotors));
+	group_scramblers_.erase(group_scramblers_.begin() + num_menu_groups_, group_scramblers_.end());
+	group_positions_.erase(group_positions_.begin() + num_menu_groups_, group_positions_.end());
+	stepped_edges_.clear();
+	stepped_groups_.clear();
+	stepped_rotors_.clear();
+	stepped_indices_.assign(menu_.edges.size(), UINT32_MAX);
+	const Letter min_offset = (turnover_offsets_.size() > 1) ? turnover_offsets_[1] : NUM_LETTERS;
+	std::array<Letter, MAX_ROTORS> positions;
+	for(uint32_t edge_idx = 0; edge_idx < menu_.edges.size(); ++edge_idx)
+	{
+		if(edge_crib_offsets_[edge_idx] < min_offset)
+		{
+			continue;
+		}
+
+		const auto& edge = menu_.edges[edge_idx];
+		std::copy(edge.rotor_positions.begin(), edge.rotor_positions.end(), positions.begin());
+		positions[fast_idx - 1] = (positions[fast_idx - 1] + 1) % NUM_LETTERS;
+		stepped_indices_[edge_idx] = static_cast<uint32_t>(stepped_edges_.size());
+		stepped_edges_.push_back(edge_idx);
+		const uint32_t group_idx =
+			groupOf(std::span(positions).first(num_rotors), std::span(rotor_models).first(num_rotors));
+		stepped_groups_.push_back(group_idx);
+		stepped_rotors_.emplace_back(rotor_models[fast_idx])
+			.setPosition(positions[fast_idx], group_scramblers_[group_idx].rotor(fast_idx - 1));
+	}
+	hypothesis_maps_.resize(menu_.edges.size());
 }
 
 const std::vector<Bombe::Stop>& Bombe::run()
 {
-	const size_t num_edges = scramblers_.size();
-	const size_t num_rotors = scramblers_[0].numRotors();
-	std::vector<Letter> rotor_offsets(num_rotors, 0);
-	const DoubleMap& null_map = nullDoubleMap();
+	if(traversal_ == Traversal::BLOCKED)
+	{
+		return runBlocked();
+	}
+
+	const size_t num_rotors = menu_.numRotors();
+	std::array<size_t, MAX_ROTORS> offset_indices{};
+	std::array<Letter, MAX_ROTORS> rotor_offsets{};
+	for(size_t k = 0; k < num_rotors; ++k)
+	{
+		rotor_offsets[k] = allowed_offsets_[k][0];
+	}
+	setRotorOffsets(std::span(rotor_offsets).first(num_rotors), 0);
+
+	// Start with the edges closest to the register; later the schedule adapts to the measured edge activities
+	std::fill(edge_activities_.begin(), edge_activities_.end(), EdgeActivity{0, 0, UINT32_MAX});
+	reorderEdges();
 
 	stops_.clear();
-	for(bool terminated = false; !terminated;)
+	PerfCounts phase_start;
+	if(perf_counters_ != nullptr)
 	{
-		// Reset wires
-		for(auto& group : wire_groups_)
+		phase_start = perf_counters_->read();
+	}
+	uint32_t position = 0;
+	for(bool terminated = false; !terminated; ++position)
+	{
+		for(size_t hypothesis = 0; hypothesis < turnover_offsets_.size(); ++hypothesis)
 		{
-			group.reset();
+			const size_t num_on = propagate(position, hypothesis);
+			if(isStop(num_on))
+			{
+				stops_.push_back(makeStop(num_on, fast_rotors_[0].position(), hypothesis));
+			}
 		}
 
-		for(size_t k = 0; k < num_edges; ++k)
+		// Step rotors through their allowed offsets
+		size_t rotor_idx = num_rotors - 1;
+		for(;; --rotor_idx)
 		{
-			const auto& from = scramblers_[k].map();
-			std::copy(from.begin(), from.begin() + NUM_LETTERS, scrambler_maps_[k].map.begin());
+			if(++offset_indices[rotor_idx] >= num_allowed_offsets_[rotor_idx])
+			{
+				offset_indices[rotor_idx] = 0;
+				rotor_offsets[rotor_idx] = allowed_offsets_[rotor_idx][0];
+				if(rotor_idx == 0)
+				{
+					terminated = true;
+					break;
+				}
+			}
+			else
+			{
+				rotor_offsets[rotor_idx] = allowed_offsets_[rotor_idx][offset_indices[rotor_idx]];
+				break;
+			}
 		}
+		if(rotor_idx < num_rotors - 1)
+		{
+			// Counters are read once per fast rotor revolution, so its fast rotor steps count as propagation
+			if(perf_counters_ != nullptr)
+			{
+				const PerfCounts now = perf_counters_->read();
+				perf_profile_->propagation += now - phase_start;
+				perf_profile_->num_positions += num_allowed_offsets_[num_rotors - 1];
+				phase_start = now;
+			}
 
-		// Apply voltage to registers
-		for(const auto& reg : menu_.registers)
+			reorderEdges();
+
+			if(position_counter_ != nullptr)
+			{
+				position_counter_->fetch_add(num_allowed_offsets_[num_rotors - 1], std::memory_order_relaxed);
+			}
+			if((cancel_flag_ != nullptr) && cancel_flag_->load(std::memory_order_relaxed))
+			{
+				// Abandon the run with the stops found so far
+				terminated = true;
+			}
+		}
+		if(!terminated)
 		{
-			wire_groups_[reg.first].set(reg.second);
-			wire_groups_[reg.second].set(reg.first); // via diagonal board
+			setRotorOffsets(std::span(rotor_offsets).first(num_rotors), rotor_idx);
 		}
+		if((perf_counters_ != nullptr) && (rotor_idx < num_rotors - 1))
+		{
+			const PerfCounts now = perf_counters_->read();
+			perf_profile_->stepping += now - phase_start;
+			phase_start = now;
+		}
+	}
+
+	return stops_;
+}
+
+const std::vector<Bombe::Stop>& Bombe::runBlocked()
+{
+	// Same positions, edge schedule updates and stops as the position-major run(), with the fast rotor stepping
+	// hoisted out: each block is one revolution of the fast rotor through its allowed offsets
+	const size_t num_rotors = menu_.numRotors();
+	const size_t fast_idx = num_rotors - 1;
+	const size_t num_edges = fast_rotors_.size();
+	const size_t block_size = num_allowed_offsets_[fast_idx];
+	const auto& fast_offsets = allowed_offsets_[fast_idx];
+	const DoubleMap& null_map = nullDoubleMap();
+	const size_t num_stepped = stepped_edges_.size();
+	block_maps_.resize(block_size * num_edges);
+	stepped_block_maps_.resize(block_size * num_stepped);
+
+	std::array<size_t, MAX_ROTORS> offset_indices{};
+	std::array<Letter, MAX_ROTORS> rotor_offsets{};
+	for(size_t k = 0; k < num_rotors; ++k)
+	{
+		rotor_offsets[k] = allowed_offsets_[k][0];
+	}
+	setGroupOffsets(std::span(rotor_offsets).first(num_rotors), 0);
 
-		// Propagate voltage
-		bool changed = true;
-		while(changed)
+	std::fill(edge_activities_.begin(), edge_activities_.end(), EdgeActivity{0, 0, UINT32_MAX});
+	reorderEdges();
+
+	stops_.clear();
+	PerfCounts phase_start;
+	if(perf_counters_ != nullptr)
+	{
+		phase_start = perf_counters_->read();
+	}
+	uint32_t position = 0;
+	for(bool terminated = false; !terminated;)
+	{
+		// Edge by edge, so the wiring and the group scrambler map stay in registers and L1 for the whole block
+		for(size_t slot = 0; slot < num_edges; ++slot)
+		{
+			const auto& scheduled = scrambler_maps_[slot];
+			Rotor& fast_rotor = fast_rotors_[scheduled.edge_idx];
+			const Letter menu_position = menu_.edges[scheduled.edge_idx].rotor_positions[fast_idx];
+			const auto& left_map = group_scramblers_[edge_groups_[scheduled.edge_idx]].rotor(fast_idx - 1);
+			for(size_t k = 0; k < block_size; ++k)
+			{
+				fast_rotor.setPosition(null_map[menu_position + fast_offsets[k]], left_map);
+				auto& block_map = block_maps_[k * num_edges + slot];
+				std::copy(fast_rotor.begin(), fast_rotor.begin() + NUM_LETTERS, block_map.map.begin());
+				block_map.nodes = scheduled.nodes;
+				block_map.edge_idx = scheduled.edge_idx;
+			}
+		}
+		for(size_t stepped_idx = 0; stepped_idx < num_stepped; ++stepped_idx)
 		{
-			changed = false;
-			for(const auto& scrambler_map : scrambler_maps_)
+			Rotor& stepped_rotor = stepped_rotors_[stepped_idx];
+			const Letter menu_position = menu_.edges[stepped_edges_[stepped_idx]].rotor_positions[fast_idx];
+			const auto& left_map = group_scramblers_[stepped_groups_[stepped_idx]].rotor(fast_idx - 1);
+			for(size_t k = 0; k < block_size; ++k)
 			{
-				const auto [group_idx1, group_idx2] = scrambler_map.nodes;
-				auto& group1 = wire_groups_[group_idx1];
-				auto& group2 = wire_groups_[group_idx2];
-				for(Letter wire1 = 0; wire1 < NUM_LETTERS; ++wire1)
+				stepped_rotor.setPosition(null_map[menu_position + fast_offsets[k]], left_map);
+				std::copy(stepped_rotor.begin(),
+				          stepped_rotor.begin() + NUM_LETTERS,
+				          stepped_block_maps_[k * num_stepped + stepped_idx].begin());
+			}
+		}
+		if(perf_counters_ != nullptr)
+		{
+			const PerfCounts now = perf_counters_->read();
+			perf_profile_->stepping += now - phase_start;
+			phase_start = now;
+		}
+
+		const Letter first_menu_position = menu_.edges[0].rotor_positions[fast_idx];
+		for(size_t k = 0; k < block_size; ++k, ++position)
+		{
+			const auto block = std::span(block_maps_).subspan(k * num_edges, num_edges);
+			for(size_t hypothesis = 0; hypothesis < turnover_offsets_.size(); ++hypothesis)
+			{
+				std::span<const ScramblerMap> schedule = block;
+				if(hypothesis > 0)
 				{
-					const Letter wire2 = scrambler_map.map[wire1];
-					if(group1[wire1] != group2[wire2])
+					// Only the edges this hypothesis steps swap in their stepped maps
+					std::copy(block.begin(), block.end(), hypothesis_maps_.begin());
+					for(auto& scrambler_map : hypothesis_maps_)
 					{
-						group1.set(wire1);
-						group2.set(wire2);
-						wire_groups_[wire1].set(group_idx1); // via diagonal board
-						wire_groups_[wire2].set(group_idx2); // via diagonal board
-						changed = true;
+						if(isStepped(scrambler_map.edge_idx, hypothesis))
+						{
+							scrambler_map.map =
+								stepped_block_maps_[k * num_stepped + stepped_indices_[scrambler_map.edge_idx]];
+						}
 					}
+					schedule = hypothesis_maps_;
+				}
+				const size_t num_on = propagate(position, schedule);
+				if(isStop(num_on))
+				{
+					stops_.push_back(makeStop(num_on, null_map[first_menu_position + fast_offsets[k]], hypothesis));
 				}
 			}
 		}
-
-		// Check register
-		const Letter reg_letter = menu_.registers[0].first;
-		const size_t num_on = wire_groups_[reg_letter].count();
-		if((num_on == 1) || (num_on == (NUM_LETTERS - 1)))
+		if(perf_counters_ != nullptr)
 		{
-			addResult(scramblers_[0], reg_letter, num_on);
+			const PerfCounts now = perf_counters_->read();
+			perf_profile_->propagation += now - phase_start;
+			perf_profile_->num_positions += block_size;
+			phase_start = now;
 		}
 
-		// Step rotors
-		size_t rotor_idx = num_rotors - 1;
+		// Step the slow and middle rotors through their allowed offsets
+		size_t rotor_idx = fast_idx - 1;
 		for(;; --rotor_idx)
 		{
-			if(++rotor_offsets[rotor_idx] >= NUM_LETTERS)
+			if(++offset_indices[rotor_idx] >= num_allowed_offsets_[rotor_idx])
 			{
-				rotor_offsets[rotor_idx] = 0;
+				offset_indices[rotor_idx] = 0;
+				rotor_offsets[rotor_idx] = allowed_offsets_[rotor_idx][0];
 				if(rotor_idx == 0)
 				{
 					terminated = true;
@@ -152,49 +419,436 @@ const std::vector<Bombe::Stop>& Bombe::run()
 			}
 			else
 			{
+				rotor_offsets[rotor_idx] = allowed_offsets_[rotor_idx][offset_indices[rotor_idx]];
 				break;
 			}
 		}
-		for(size_t edge_idx = 0; edge_idx < num_edges; ++edge_idx)
+		reorderEdges();
+
+		if(position_counter_ != nullptr)
+		{
+			position_counter_->fetch_add(block_size, std::memory_order_relaxed);
+		}
+		if((cancel_flag_ != nullptr) && cancel_flag_->load(std::memory_order_relaxed))
+		{
+			terminated = true;
+		}
+		if(!terminated)
+		{
+			setGroupOffsets(std::span(rotor_offsets).first(num_rotors), rotor_idx);
+		}
+		if(perf_counters_ != nullptr)
 		{
-			const auto& edge = menu_.edges[edge_idx];
-			auto& scrambler = scramblers_[edge_idx];
-			for(size_t k = rotor_idx; k < num_rotors; ++k)
+			const PerfCounts now = perf_counters_->read();
+			perf_profile_->stepping += now - phase_start;
+			phase_start = now;
+		}
+	}
+
+	return stops_;
+}
+
+const std::vector<Bombe::Stop>& Bombe::runPositions(std::span<const uint32_t> offset_indices)
+{
+	const size_t num_rotors = menu_.numRotors();
+	std::array<Letter, MAX_ROTORS> offsets;
+	const auto rotor_offsets = std::span(offsets).first(num_rotors);
+
+	stops_.clear();
+	PerfCounts chunk_start;
+	uint64_t chunk_positions = 0;
+	const auto add_chunk_profile = [&]() {
+		// Once per chunk of positions; rotor setting counts as propagation, as each position sets all rotors anew
+		if(perf_counters_ != nullptr)
+		{
+			const PerfCounts now = perf_counters_->read();
+			perf_profile_->propagation += now - chunk_start;
+			perf_profile_->num_positions += chunk_positions;
+			chunk_start = now;
+			chunk_positions = 0;
+		}
+	};
+	add_chunk_profile();
+	for(size_t idx = 0; idx < offset_indices.size(); ++idx)
+	{
+		if((idx % 4096) == 0)
+		{
+			add_chunk_profile();
+			if((cancel_flag_ != nullptr) && cancel_flag_->load(std::memory_order_relaxed))
 			{
-				scrambler.setRotorPosition(k, null_map[edge.rotor_positions[k] + rotor_offsets[k]]);
+				break;
+			}
+		}
+
+		decodePositions(offset_indices[idx], rotor_offsets);
+		bool allowed = true;
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			allowed &= ((allowed_offset_masks_[k] >> rotor_offsets[k]) & 1) != 0;
+		}
+		if(allowed)
+		{
+			++chunk_positions;
+			if(const auto stop = testPosition(rotor_offsets))
+			{
+				stops_.push_back(*stop);
+			}
+			// testPosition() left the rotors at this position for the turnover hypotheses
+			for(size_t hypothesis = 1; hypothesis < turnover_offsets_.size(); ++hypothesis)
+			{
+				const size_t num_on = propagate(0, hypothesis);
+				if(isStop(num_on))
+				{
+					stops_.push_back(makeStop(num_on, fast_rotors_[0].position(), hypothesis));
+				}
 			}
 		}
 	}
+	add_chunk_profile();
 
+	if(position_counter_ != nullptr)
+	{
+		uint64_t num_positions = 1;
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			num_positions *= num_allowed_offsets_[k];
+		}
+		position_counter_->fetch_add(num_positions, std::memory_order_relaxed);
+	}
 	return stops_;
 }
 
-void Bombe::addResult(const Scrambler& first_scrambler, Letter reg_letter, size_t num_on)
+std::optional<Bombe::Stop> Bombe::test(std::span<const Letter> rotor_offsets)
 {
-	stops_.emplace_back();
-	auto& stop = stops_.back();
+	const size_t num_rotors = menu_.numRotors();
+	if(rotor_offsets.size() != num_rotors)
+	{
+		throw std::invalid_argument("Rotor offsets do not match the bombe menu");
+	}
 
-	stop.reflector_model = reflector_model_;
-	stop.rotor_models = rotor_models_;
+	if(perf_counters_ == nullptr)
+	{
+		return testPosition(rotor_offsets);
+	}
 
-	const auto num_rotors = first_scrambler.numRotors();
-	stop.rotor_positions.resize(num_rotors);
-	for(size_t k = 0; k < num_rotors; ++k)
+	const PerfCounts start = perf_counters_->read();
+	setRotorOffsets(rotor_offsets, 0);
+	const PerfCounts stepped = perf_counters_->read();
+	const size_t num_on = propagate(0, 0);
+	const PerfCounts propagated = perf_counters_->read();
+	perf_profile_->stepping += stepped - start;
+	perf_profile_->propagation += propagated - stepped;
+	++perf_profile_->num_positions;
+	return isStop(num_on) ? std::optional(makeStop(num_on, fast_rotors_[0].position(), 0)) : std::nullopt;
+}
+
+std::optional<Bombe::Stop> Bombe::testPosition(std::span<const Letter> rotor_offsets)
+{
+	setRotorOffsets(rotor_offsets, 0);
+	const size_t num_on = propagate(0, 0);
+	return isStop(num_on) ? std::optional(makeStop(num_on, fast_rotors_[0].position(), 0)) : std::nullopt;
+}
+
+void Bombe::setSearchSpace(const SearchSpace& search_space)
+{
+	const auto& first_edge = menu_.edges[0];
+	for(size_t k = 0; k < menu_.numRotors(); ++k)
 	{
-		stop.rotor_positions[k] = first_scrambler.rotor(k).position();
+		// Offsets from the first edge's position, so the full search space steps exactly as an unconstrained run
+		num_allowed_offsets_[k] = 0;
+		allowed_offset_masks_[k] = 0;
+		for(Letter offset = 0; offset < NUM_LETTERS; ++offset)
+		{
+			if(search_space.positions[k][(first_edge.rotor_positions[k] + offset) % NUM_LETTERS])
+			{
+				allowed_offsets_[k][num_allowed_offsets_[k]++] = offset;
+				allowed_offset_masks_[k] |= 1u << offset;
+			}
+		}
+		if(num_allowed_offsets_[k] == 0)
+		{
+			throw std::invalid_argument("Empty search space");
+		}
 	}
+}
 
-	stop.stecker.first = reg_letter;
-	const bool voltaged = (num_on == 1);
-	const auto& wires = wire_groups_[reg_letter];
-	for(Letter k = 0; k < NUM_LETTERS; ++k)
+size_t Bombe::propagate(uint32_t position, size_t hypothesis)
+{
+	for(auto& scrambler_map : scrambler_maps_)
 	{
-		if(wires[k] == voltaged)
+		const uint32_t edge_idx = scrambler_map.edge_idx;
+		const auto& from = isStepped(edge_idx, hypothesis) ? stepped_rotors_[stepped_indices_[edge_idx]]
+		                                                   : fast_rotors_[edge_idx];
+		std::copy(from.begin(), from.begin() + NUM_LETTERS, scrambler_map.map.begin());
+	}
+	return propagate(position, scrambler_maps_);
+}
+
+size_t Bombe::propagate(uint32_t position, std::span<const ScramblerMap> schedule)
+{
+	const size_t num_edges = schedule.size();
+
+	// Reset wires and apply voltage to registers
+	wires_.fill(0);
+	for(const auto& reg : menu_.registers)
+	{
+		wires_[reg.first] |= 1u << reg.second;
+	}
+
+	// Propagate voltage. Within a sweep only the scrambler connections are followed; the diagonal board is then
+	// closed in bulk by OR-ing the wire matrix with its transpose.
+	// An edge is skipped while none of its two cables changed since it was last applied. Once all register wires are
+	// live the position is rejected, whatever the rest of the menu does.
+	const Letter reg_letter = menu_.registers[0].first;
+	constexpr uint32_t all_wires = (1u << NUM_LETTERS) - 1;
+	uint32_t clock = 1;
+	row_stamps_.fill(clock);
+	std::fill(edge_stamps_.begin(), edge_stamps_.end(), 0);
+	bool changed = true;
+	for(uint32_t sweep_start = 0; changed; sweep_start += static_cast<uint32_t>(num_edges))
+	{
+		changed = false;
+		for(size_t slot = 0; slot < num_edges; ++slot)
 		{
-			stop.stecker.second = k;
-			break;
+			const auto& scrambler_map = schedule[slot];
+			const auto [group_idx1, group_idx2] = scrambler_map.nodes;
+			auto& edge_stamp = edge_stamps_[slot];
+			if((row_stamps_[group_idx1] <= edge_stamp) && (row_stamps_[group_idx2] <= edge_stamp))
+			{
+				continue;
+			}
+
+			const uint32_t old_group1 = wires_[group_idx1];
+			const uint32_t old_group2 = wires_[group_idx2];
+			if((old_group1 | old_group2) == 0)
+			{
+				continue;
+			}
+
+			// Each wire pair (wire1, wire2) is visited exactly once, so the old wire states can be used throughout
+			uint32_t group1 = old_group1;
+			uint32_t group2 = old_group2;
+			for(Letter wire1 = 0; wire1 < NUM_LETTERS; ++wire1)
+			{
+				const Letter wire2 = scrambler_map.map[wire1];
+				const uint32_t on = ((old_group1 >> wire1) | (old_group2 >> wire2)) & 1;
+				group1 |= on << wire1;
+				group2 |= on << wire2;
+			}
+
+			++clock;
+			if((group1 != old_group1) || (group2 != old_group2))
+			{
+				wires_[group_idx1] |= group1;
+				wires_[group_idx2] |= group2;
+				row_stamps_[group_idx1] = clock;
+				row_stamps_[group_idx2] = clock;
+				changed = true;
+				if(wires_[reg_letter] == all_wires)
+				{
+					return NUM_LETTERS;
+				}
+
+				auto& activity = edge_activities_[scrambler_map.edge_idx];
+				if(activity.last_position != position)
+				{
+					activity.last_position = position;
+					activity.first_flip_sum += sweep_start + static_cast<uint32_t>(slot);
+					++activity.num_positions;
+				}
+			}
+			// One pass closes an edge between two different cables; a self-connected cable may need another pass
+			edge_stamp = (group_idx1 != group_idx2) ? clock : 0;
+		}
+
+		// Diagonal board (left out by the screen, which then only follows scrambler connections)
+		if(screening_)
+		{
+			continue;
+		}
+		transposed_wires_ = wires_;
+		transpose(transposed_wires_);
+		++clock;
+		for(size_t row = 0; row < NUM_LETTERS; ++row)
+		{
+			if((transposed_wires_[row] & ~wires_[row]) != 0)
+			{
+				wires_[row] |= transposed_wires_[row];
+				row_stamps_[row] = clock;
+				changed = true;
+			}
 		}
+		if(wires_[reg_letter] == all_wires)
+		{
+			return NUM_LETTERS;
+		}
+	}
+
+	return static_cast<size_t>(std::popcount(wires_[reg_letter]));
+}
+
+void Bombe::setRotorOffsets(std::span<const Letter> rotor_offsets, size_t first_rotor)
+{
+	setGroupOffsets(rotor_offsets, first_rotor);
+
+	const DoubleMap& null_map = nullDoubleMap();
+	const size_t fast_idx = rotor_offsets.size() - 1;
+	for(size_t edge_idx = 0; edge_idx < fast_rotors_.size(); ++edge_idx)
+	{
+		const auto& edge = menu_.edges[edge_idx];
+		fast_rotors_[edge_idx].setPosition(null_map[edge.rotor_positions[fast_idx] + rotor_offsets[fast_idx]],
+		                                   group_scramblers_[edge_groups_[edge_idx]].rotor(fast_idx - 1));
+	}
+	for(size_t stepped_idx = 0; stepped_idx < stepped_rotors_.size(); ++stepped_idx)
+	{
+		const auto& edge = menu_.edges[stepped_edges_[stepped_idx]];
+		stepped_rotors_[stepped_idx].setPosition(null_map[edge.rotor_positions[fast_idx] + rotor_offsets[fast_idx]],
+		                                         group_scramblers_[stepped_groups_[stepped_idx]].rotor(fast_idx - 1));
+	}
+}
+
+uint32_t Bombe::groupOf(std::span<const Letter> rotor_positions, std::span<const RotorModel> rotor_models)
+{
+	const size_t fast_idx = rotor_positions.size() - 1;
+	for(size_t group_idx = 0; group_idx < group_positions_.size(); ++group_idx)
+	{
+		if(std::equal(rotor_positions.begin(), rotor_positions.begin() + fast_idx, group_positions_[group_idx].begin()))
+		{
+			return static_cast<uint32_t>(group_idx);
+		}
+	}
+
+	auto& group_positions = group_positions_.emplace_back();
+	std::copy(rotor_positions.begin(), rotor_positions.end(), group_positions.begin());
+	auto& group_scrambler = group_scramblers_.emplace_back(reflector_model_, rotor_models);
+	for(size_t k = 0; k < fast_idx; ++k)
+	{
+		group_scrambler.setRotorPosition(k, rotor_positions[k]);
 	}
+	return static_cast<uint32_t>(group_scramblers_.size() - 1);
+}
+
+void Bombe::setGroupOffsets(std::span<const Letter> rotor_offsets, size_t first_rotor)
+{
+	const DoubleMap& null_map = nullDoubleMap();
+	const size_t fast_idx = rotor_offsets.size() - 1;
+	for(size_t group_idx = 0; group_idx < group_scramblers_.size(); ++group_idx)
+	{
+		const auto& group_positions = group_positions_[group_idx];
+		auto& group_scrambler = group_scramblers_[group_idx];
+		for(size_t k = first_rotor; k < fast_idx; ++k)
+		{
+			group_scrambler.setRotorPosition(k, null_map[group_positions[k] + rotor_offsets[k]]);
+		}
+	}
+}
+
+void Bombe::setMonitor(std::atomic<uint64_t>* position_counter, const std::atomic<bool>* cancel_flag)
+{
+	position_counter_ = position_counter;
+	cancel_flag_ = cancel_flag;
+}
+
+void Bombe::setProfiler(const PerfCounters* counters, PerfProfile* profile)
+{
+	perf_counters_ = counters;
+	perf_profile_ = profile;
+}
+
+void Bombe::computeRegisterDistances()
+{
+	// Breadth-first search over menu letters, starting from the register
+	std::array<uint32_t, NUM_LETTERS> letter_distances;
+	letter_distances.fill(UINT32_MAX);
+	std::deque<Letter> queue;
+	const Letter reg_letter = menu_.registers[0].first;
+	letter_distances[reg_letter] = 0;
+	queue.push_back(reg_letter);
+	while(!queue.empty())
+	{
+		const Letter letter = queue.front();
+		queue.pop_front();
+		for(const auto& edge : menu_.edges)
+		{
+			const auto [l1, l2] = edge.nodes;
+			const Letter other = (l1 == letter) ? l2 : ((l2 == letter) ? l1 : letter);
+			if(letter_distances[other] == UINT32_MAX)
+			{
+				letter_distances[other] = letter_distances[letter] + 1;
+				queue.push_back(other);
+			}
+		}
+	}
+
+	edge_distances_.resize(menu_.edges.size());
+	for(size_t edge_idx = 0; edge_idx < menu_.edges.size(); ++edge_idx)
+	{
+		const auto [l1, l2] = menu_.edges[edge_idx].nodes;
+		edge_distances_[edge_idx] = std::min(letter_distances[l1], letter_distances[l2]);
+	}
+}
+
+void Bombe::reorderEdges()
+{
+	// Edges are scheduled by the mean time at which they first did useful work, so voltage flows along the schedule
+	// and fewer sweeps are needed. Idle edges go last; ties are broken by the distance from the register.
+	// The propagation converges to the same wire state in any edge order, so stops are not affected.
+	const auto sort_key = [this](const ScramblerMap& scrambler_map) {
+		const auto& activity = edge_activities_[scrambler_map.edge_idx];
+		const double mean_first_flip = (activity.num_positions == 0)
+			? std::numeric_limits<double>::max()
+			: double(activity.first_flip_sum) / activity.num_positions;
+		return std::make_pair(mean_first_flip, edge_distances_[scrambler_map.edge_idx]);
+	};
+	// Insertion sort: stable, allocation free, and the schedule is usually almost sorted already
+	for(size_t k = 1; k < scrambler_maps_.size(); ++k)
+	{
+		const ScramblerMap scrambler_map = scrambler_maps_[k];
+		const auto key = sort_key(scrambler_map);
+		size_t slot = k;
+		for(; (slot > 0) && (key < sort_key(scrambler_maps_[slot - 1])); --slot)
+		{
+			scrambler_maps_[slot] = scrambler_maps_[slot - 1];
+		}
+		scrambler_maps_[slot] = scrambler_map;
+	}
+
+	// Exponential decay, so the schedule follows the activity of recent positions
+	for(auto& activity : edge_activities_)
+	{
+		activity.first_flip_sum >>= 1;
+		activity.num_positions >>= 1;
+	}
+}
+
+Bombe::Stop Bombe::makeStop(size_t num_on, Letter fast_position, size_t hypothesis) const
+{
+	const size_t num_rotors = menu_.numRotors();
+	const auto& first_scrambler = group_scramblers_[edge_groups_[0]];
+	Stop stop;
+
+	stop.reflector_model = reflector_model_;
+	stop.num_rotors = static_cast<uint8_t>(num_rotors);
+	stop.wheel_order = wheel_order_;
+	const Letter first_position = menu_.edges[0].rotor_positions[num_rotors - 1];
+	stop.turnover = (hypothesis == 0)
+		? 0
+		: static_cast<uint16_t>(1 + (first_position + turnover_offsets_[hypothesis]) % NUM_LETTERS);
+
+	std::array<Letter, MAX_ROTORS> rotor_positions;
+	for(size_t k = 0; k + 1 < num_rotors; ++k)
+	{
+		rotor_positions[k] = first_scrambler.rotor(k).position();
+	}
+	rotor_positions[num_rotors - 1] = fast_position;
+	stop.position_index = encodePositions(std::span(rotor_positions).first(num_rotors));
+
+	const Letter reg_letter = menu_.registers[0].first;
+	stop.stecker[0] = reg_letter;
+	const uint32_t wires = wires_[reg_letter];
+	const uint32_t voltaged = (num_on == 1) ? wires : (~wires & ((1u << NUM_LETTERS) - 1));
+	stop.stecker[1] = static_cast<Letter>(std::countr_zero(voltaged));
+	return stop;
 }
 
 } // namespace bombe
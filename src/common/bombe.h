@@ -1,7 +1,16 @@
 #ifndef BOMBE_BOMBE_H
 #define BOMBE_BOMBE_H
 
+#include "bit_matrix.h"
+#include "perf_counters.h"
 #include "scrambler.h"
+#include "search_space.h"
+#include "stop.h"
+
+#include <atomic>
+#include <bitset>
+#include <optional>
+#include <vector>
 
 namespace bombe {
 
@@ -25,19 +34,69 @@ public:
 		}
 	};
 
-	struct Stop
+	using Stop = bombe::Stop;
+
+	// Order in which run() visits positions. Both give the same stops in the same order.
+	enum class Traversal : uint8_t
 	{
-		ReflectorModel reflector_model;
-		std::vector<RotorModel> rotor_models;
-		std::vector<Letter> rotor_positions;
-		std::pair<Letter, Letter> stecker;
+		POSITION_MAJOR, // all edges at one position, then the next position
+		BLOCKED,        // maps of a whole fast rotor revolution generated edge by edge, then propagated by position
 	};
 
 public:
 	Bombe(const Menu& menu, ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
 
+	// Swap reflector and rotor models in place, keeping the menu and all buffers (no allocation)
+	void reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
+
 	const std::vector<Stop>& run();
 
+	// Run only the given positions (encoded rotor offsets from the menu positions, as in test()) within the search
+	// space, such as the candidates of a LoopIndex. Stops are those of run() at these positions, in the same order.
+	const std::vector<Stop>& runPositions(std::span<const uint32_t> offset_indices);
+
+	// Test a single position, given as rotor offsets from the menu positions (without stepping), for the menu as
+	// written (no turnover hypothesis)
+	std::optional<Stop> test(std::span<const Letter> rotor_offsets);
+
+	// Restrict run() to the given rotor positions (default: all positions); kept across reconfigure()
+	void setSearchSpace(const SearchSpace& search_space);
+
+	// Kept across reconfigure() (default: BLOCKED)
+	void setTraversal(Traversal traversal)
+	{
+		traversal_ = traversal;
+	}
+
+	// Besides the menu as written, also search it with the middle rotor stepped once from each given fast rotor menu
+	// position on, i.e. for the edges at and after that position in crib order. Edges are in crib order by their fast
+	// rotor position counted from the first edge's, so the menu must not step the middle rotor itself and the first
+	// edge must be the earliest crib letter, i.e. follow the largest gap between the fast rotor positions (throws
+	// otherwise). Edges that only some hypotheses step share their
+	// unstepped maps with the others. Stops are tagged with their hypothesis
+	// (Stop::turnover), and come in hypothesis order at each position. Kept across reconfigure() (default: none).
+	void setTurnoverHypotheses(const std::bitset<NUM_LETTERS>& turnover_positions);
+
+	// Screening for a larger menu: follow the scrambler connections only (no diagonal board), and report every position
+	// at which not all register wires are live. Edges and the diagonal board only add live wires, so a position this
+	// rejects is no stop of any menu holding these edges. The stecker of a report is its first dead wire.
+	// Kept across reconfigure() (default: off).
+	void setScreening(bool screening)
+	{
+		screening_ = screening;
+	}
+
+	// Optional monitoring by another thread: run() adds the number of finished positions to position_counter, and
+	// returns early (with the stops found so far) once cancel_flag is set. Both are checked once per middle rotor step.
+	void setMonitor(std::atomic<uint64_t>* position_counter, const std::atomic<bool>* cancel_flag);
+
+	// Optional profiling (counters of the calling thread): run(), runPositions() and test() add the counts of their
+	// propagation and stepping phases to profile. Runs read the counters a few times per fast rotor revolution (once
+	// per 4096 positions for runPositions()), so stepping only covers what happens between these reads: the fast rotor
+	// steps of a position-major run, and all rotor setting of runPositions(), count as propagation. A single test()
+	// splits its phases exactly.
+	void setProfiler(const PerfCounters* counters, PerfProfile* profile);
+
 	static Menu loadMenu(std::span<const std::string> lines);
 
 private:
@@ -45,20 +104,88 @@ private:
 	{
 		SingleMap map;
 		std::pair<Letter, Letter> nodes;
-		uint32_t padding;
+		uint32_t edge_idx;
 	};
 	static_assert(sizeof(ScramblerMap) == 32, "Invalid ScramblerMap size");
 
-	void addResult(const Scrambler& first_scrambler, Letter reg_letter, size_t num_on);
+	// Runtime statistics of an edge, used for re-ordering the edge schedule
+	struct EdgeActivity
+	{
+		uint32_t first_flip_sum; // sum of (sweep * num_edges + slot) at which the edge first flipped a wire
+		uint32_t num_positions;  // number of positions in which the edge flipped any wire
+		uint32_t last_position;  // last position in which the edge flipped a wire
+	};
+
+	const std::vector<Stop>& runBlocked();
+
+	// test() without profiling
+	std::optional<Stop> testPosition(std::span<const Letter> rotor_offsets);
+
+	// Propagate voltage from the registers at the current rotor positions, returning the number of live register wires
+	size_t propagate(uint32_t position, size_t hypothesis);
+
+	// Same with the maps of one position, in schedule order
+	size_t propagate(uint32_t position, std::span<const ScramblerMap> schedule);
+
+	// Group scrambler at the given menu positions of the reflector-side rotors, shared with earlier edges if possible
+	uint32_t groupOf(std::span<const Letter> rotor_positions, std::span<const RotorModel> rotor_models);
+
+	bool isStepped(uint32_t edge_idx, size_t hypothesis) const
+	{
+		return edge_crib_offsets_[edge_idx] >= turnover_offsets_[hypothesis];
+	}
+
+	void setRotorOffsets(std::span<const Letter> rotor_offsets, size_t first_rotor);
+
+	// Group scramblers only (reflector and all rotors but the fast one)
+	void setGroupOffsets(std::span<const Letter> rotor_offsets, size_t first_rotor);
+
+	void computeRegisterDistances();
+
+	void reorderEdges();
+
+	bool isStop(size_t num_on) const
+	{
+		return screening_ ? (num_on < NUM_LETTERS) : ((num_on == 1) || (num_on == (NUM_LETTERS - 1)));
+	}
+
+	Stop makeStop(size_t num_on, Letter fast_position, size_t hypothesis) const;
 
 private:
-	std::array<std::bitset<NUM_LETTERS>, NUM_LETTERS> wire_groups_;
+	BitMatrix wires_; // bit w of row n: wire w of the letter n cable
+	BitMatrix transposed_wires_;
+	std::array<uint32_t, NUM_LETTERS> row_stamps_; // propagation clock of the last change of each cable
 	const Menu& menu_;
-	const ReflectorModel reflector_model_;
-	const std::vector<RotorModel> rotor_models_;
-	std::vector<Scrambler> scramblers_;
-	std::vector<ScramblerMap> scrambler_maps_;
+	ReflectorModel reflector_model_;
+	uint16_t wheel_order_;
+	std::vector<Scrambler> group_scramblers_; // reflector and all rotors but the fast one, per slow/middle positions
+	std::vector<std::array<Letter, MAX_ROTORS>> group_positions_; // menu positions of each group
+	size_t num_menu_groups_{0}; // groups of the menu as written; stepped groups follow
+	std::vector<Rotor> fast_rotors_;           // per edge, on top of its group's scrambler
+	std::vector<uint32_t> edge_groups_;
+	std::vector<ScramblerMap> scrambler_maps_; // in schedule order
+	std::vector<ScramblerMap> block_maps_;     // BLOCKED: per fast rotor offset, the maps in schedule order
+	std::vector<uint32_t> edge_stamps_;        // propagation clock of the last application of each scheduled edge
+	std::vector<EdgeActivity> edge_activities_;
+	std::vector<uint32_t> edge_distances_; // distance from the register letter, in edges
+	std::vector<Letter> edge_crib_offsets_;     // fast rotor position counted from the first edge's
+	std::vector<Letter> turnover_offsets_;      // per hypothesis, the crib offset from which edges step (26 for none)
+	std::vector<uint32_t> stepped_edges_;       // edges stepped by any hypothesis
+	std::vector<uint32_t> stepped_indices_;     // per edge, its index in stepped_edges_ (if any)
+	std::vector<uint32_t> stepped_groups_;      // per stepped edge, its group with the middle rotor one step on
+	std::vector<Rotor> stepped_rotors_;         // per stepped edge, on top of its stepped group's scrambler
+	std::vector<SingleMap> stepped_block_maps_; // BLOCKED: per fast rotor offset, the maps of the stepped edges
+	std::vector<ScramblerMap> hypothesis_maps_; // schedule of one hypothesis
 	std::vector<Stop> stops_;
+	std::array<std::array<Letter, NUM_LETTERS>, MAX_ROTORS> allowed_offsets_; // rotor offsets in stepping order
+	std::array<size_t, MAX_ROTORS> num_allowed_offsets_;
+	std::array<uint32_t, MAX_ROTORS> allowed_offset_masks_;
+	std::atomic<uint64_t>* position_counter_{nullptr};
+	const std::atomic<bool>* cancel_flag_{nullptr};
+	const PerfCounters* perf_counters_{nullptr};
+	PerfProfile* perf_profile_{nullptr};
+	Traversal traversal_{Traversal::BLOCKED};
+	bool screening_{false};
 };
 
 } // namespace bombe
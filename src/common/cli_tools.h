@@ -5,6 +5,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 namespace bombe::cli {
@@ -39,21 +40,12 @@ std::vector<bombe::RotorModel> parseRotorModels(std::span<const char* const>& ar
 
 void printStops(std::span<const bombe::Bombe::Stop> stops)
 {
+	std::array<char, MAX_STOP_TEXT_SIZE + 1> text;
 	for(const auto& stop : stops)
 	{
-		std::ostringstream ss;
-		ss << int(stop.reflector_model);
-		for(const auto rotor_model : stop.rotor_models)
-		{
-			ss << ' ' << int(rotor_model);
-		}
-
-		std::string pos_letters(stop.rotor_positions.size(), ' ');
-		letter2Char(stop.rotor_positions, pos_letters);
-		ss << "    " << pos_letters;
-		ss << " " << letter2Char(stop.stecker.first) << ':' << letter2Char(stop.stecker.second);
-
-		std::cout << ss.str() << "\n";
+		const size_t size = formatStopText(stop, std::span(text).first<MAX_STOP_TEXT_SIZE>());
+		text[size] = '\n';
+		std::cout.write(text.data(), size + 1);
 	}
 }
 
@@ -82,6 +74,48 @@ bombe::Bombe::Menu parseMenu(std::span<const char* const>& args)
 	return bombe::Bombe::loadMenu(lines);
 }
 
+using Options = std::map<std::string, std::string, std::less<>>;
+
+// Parse trailing options in the form of "--name" or "--name=value"
+Options parseOptions(std::span<const char* const>& args)
+{
+	Options options;
+	for(const std::string_view arg : args)
+	{
+		if(!arg.starts_with("--") || (arg.size() == 2))
+		{
+			throw std::invalid_argument("Invalid option " + std::string(arg) + "\n");
+		}
+
+		const size_t eq = arg.find('=');
+		if(eq == std::string_view::npos)
+		{
+			options.emplace(arg.substr(2), "");
+		}
+		else
+		{
+			options.emplace(arg.substr(2, eq - 2), arg.substr(eq + 1));
+		}
+	}
+
+	args = {};
+	return options;
+}
+
+// Rotor positions to search, from "--positions=<spec>" (default: all positions)
+SearchSpace searchSpaceOption(const Options& options, size_t num_rotors)
+{
+	const auto it = options.find("positions");
+	return (it != options.end()) ? parseSearchSpace(it->second, num_rotors) : SearchSpace();
+}
+
+// Numeric option "--<name>=<n>" (default_value when absent)
+size_t optionValue(const Options& options, std::string_view name, size_t default_value)
+{
+	const auto it = options.find(name);
+	return (it != options.end()) ? std::stoull(it->second) : default_value;
+}
+
 } // namespace bombe::cli
 
 #endif // BOMBE_CLI_TOOLS_H
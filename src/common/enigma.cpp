@@ -1,7 +1,49 @@
 #include "enigma.h"
 
+#include <numeric>
+
 namespace bombe {
 
+SingleMap parseSteckers(std::string_view stecker_setting)
+{
+	std::string stecker_setting_pruned;
+	for(const char ch : stecker_setting)
+	{
+		if((ch != ':') && (ch != ' '))
+		{
+			stecker_setting_pruned.push_back(ch);
+		}
+	}
+
+	const size_t numSteckers = stecker_setting_pruned.size() / 2;
+	if((numSteckers * 2) != stecker_setting_pruned.size())
+	{
+		throw std::invalid_argument("stecker_setting must have even length");
+	}
+
+	SingleMap steckers;
+	std::iota(steckers.begin(), steckers.end(), Letter(0));
+
+	std::vector<Letter> stecker_letters(numSteckers * 2);
+	char2Letter(stecker_setting_pruned, stecker_letters);
+	for(size_t idx = 0; idx < numSteckers; ++idx)
+	{
+		const auto l1 = stecker_letters[idx * 2];
+		const auto l2 = stecker_letters[idx * 2 + 1];
+		if(l1 == l2)
+		{
+			throw std::invalid_argument("Invalid stecker pair");
+		}
+		if((steckers[l1] != l1) || (steckers[l2] != l2))
+		{
+			throw std::invalid_argument("Duplicated steckers");
+		}
+		steckers[l1] = l2;
+		steckers[l2] = l1;
+	}
+	return steckers;
+}
+
 Enigma::Enigma(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
 	: scrambler_{reflector_model, rotor_models}
 {
@@ -31,68 +73,91 @@ void Enigma::configureRotors(std::string_view ringstellung, std::string_view gru
 		const Rotor& rotor = scrambler_.rotor(rotor_idx);
 		scrambler_.setRotorPosition(rotor_idx, null_map[grundstellung_letters[rotor_idx] + NUM_LETTERS - rotor.ring()]);
 	}
+
+	const size_t slow_idx = num_rotors - 3;
+	schedule_.emplace(std::array{scrambler_.rotor(slow_idx).position(),
+	                             scrambler_.rotor(slow_idx + 1).position(),
+	                             scrambler_.rotor(slow_idx + 2).position()},
+	                  scrambler_.rotor(slow_idx + 1).turnovers(),
+	                  scrambler_.rotor(slow_idx + 2).turnovers());
 }
 
 void Enigma::configureSteckers(std::string_view stecker_setting)
 {
-	std::string stecker_setting_pruned;
-	for(const char ch : stecker_setting)
+	steckers_ = parseSteckers(stecker_setting);
+}
+
+void Enigma::configureReflectorWiring(std::string_view pairs)
+{
+	scrambler_.setReflectorWiring(parseReflectorWiring(pairs));
+
+	// Compose the rotors again on top of the new wiring, keeping their positions
+	for(size_t rotor_idx = 0; rotor_idx < scrambler_.numRotors(); ++rotor_idx)
 	{
-		if((ch != ':') && (ch != ' '))
-		{
-			stecker_setting_pruned.push_back(ch);
-		}
+		scrambler_.setRotorPosition(rotor_idx, scrambler_.rotor(rotor_idx).position());
 	}
+}
 
-	const size_t numSteckers = stecker_setting_pruned.size() / 2;
-	if((numSteckers * 2) != stecker_setting_pruned.size())
+void Enigma::process(std::span<const Letter> input, std::span<Letter> output)
+{
+	if(input.size() != output.size())
 	{
-		throw std::invalid_argument("stecker_setting must have even length");
+		throw std::invalid_argument("Enigma::process(): input/output must have the same size");
 	}
 
-	resetSteckers();
-
-	std::vector<Letter> stecker_letters(numSteckers * 2);
-	char2Letter(stecker_setting_pruned, stecker_letters);
-	for(size_t idx = 0; idx < numSteckers; ++idx)
+	for(size_t k = 0; k < input.size(); ++k)
 	{
-		const auto l1 = stecker_letters[idx * 2];
-		const auto l2 = stecker_letters[idx * 2 + 1];
-		if(l1 == l2)
-		{
-			throw std::invalid_argument("Invalid stecker pair");
-		}
-		if((steckers_[l1] != l1) || (steckers_[l2] != l2))
-		{
-			throw std::invalid_argument("Duplicated steckers");
-		}
-		steckers_[l1] = l2;
-		steckers_[l2] = l1;
+		stepScrambler();
+		output[k] = steckers_[scrambler_.map()[steckers_[input[k]]]];
 	}
 }
 
-void Enigma::process(std::span<const Letter> input, std::span<Letter> output)
+void Enigma::process(std::string_view input, std::span<char> output)
 {
 	if(input.size() != output.size())
 	{
 		throw std::invalid_argument("Enigma::process(): input/output must have the same size");
 	}
 
+	// Validated first, so invalid input leaves the machine and the output untouched. Then letter by letter, so bulk
+	// processing does not allocate.
+	for(const char ch : input)
+	{
+		char2Letter(ch);
+	}
 	for(size_t k = 0; k < input.size(); ++k)
 	{
 		stepScrambler();
-		output[k] = steckers_[scrambler_.map()[steckers_[input[k]]]];
+		output[k] = letter2Char(steckers_[scrambler_.map()[steckers_[char2Letter(input[k])]]]);
 	}
 }
 
-void Enigma::process(std::string_view input, std::span<char> output)
+void Enigma::seek(size_t offset)
 {
-	std::vector<Letter> input_letters(input.size());
-	std::vector<Letter> output_letters(output.size());
+	if(!schedule_)
+	{
+		throw std::logic_error("Enigma::seek(): rotors not configured");
+	}
+
+	const auto positions = schedule_->positionsAfter(offset);
+	const size_t slow_idx = scrambler_.numRotors() - 3;
+	for(size_t k = 0; k < positions.size(); ++k)
+	{
+		scrambler_.setRotorPosition(slow_idx + k, positions[k]);
+	}
+}
 
-	char2Letter(input, input_letters);
-	process(input_letters, output_letters);
-	letter2Char(output_letters, output);
+SingleMap Enigma::mapAt(size_t offset)
+{
+	seek(offset);
+	stepScrambler();
+
+	SingleMap map;
+	for(Letter k = 0; k < NUM_LETTERS; ++k)
+	{
+		map[k] = steckers_[scrambler_.map()[steckers_[k]]];
+	}
+	return map;
 }
 
 void Enigma::resetSteckers()
@@ -2,9 +2,16 @@
 #define BOMBE_ENIGMA_H
 
 #include "scrambler.h"
+#include "stepping.h"
+
+#include <optional>
+#include <vector>
 
 namespace bombe {
 
+// Stecker map of a setting such as "AB:CD:EF" (pairs may also be separated by spaces or not at all)
+SingleMap parseSteckers(std::string_view stecker_setting);
+
 class Enigma
 {
 public:
@@ -14,10 +21,21 @@ public:
 
 	void configureSteckers(std::string_view stecker_setting);
 
+	// Plug a rewirable reflector (UKW-D) with 13 pairs such as "AB:CD:..."; replaces the reflector of the model
+	void configureReflectorWiring(std::string_view pairs);
+
 	void process(std::span<const Letter> input, std::span<Letter> output);
 
 	void process(std::string_view input, std::span<char> output);
 
+	// Position the machine so that the next processed letter is the message letter at the given offset
+	// (counted from the Grundstellung set by configureRotors())
+	void seek(size_t offset);
+
+	// Substitution (including steckers) of the message letter at the given offset.
+	// The machine is left positioned after that letter.
+	SingleMap mapAt(size_t offset);
+
 private:
 	void resetSteckers();
 
@@ -26,6 +44,7 @@ private:
 private:
 	Scrambler scrambler_;
 	SingleMap steckers_;
+	std::optional<SteppingSchedule> schedule_;
 };
 
 } // namespace bombe
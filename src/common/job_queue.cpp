@@ -0,0 +1,85 @@
+#include "job_queue.h"
+
+namespace bombe {
+
+void JobQueue::push(const std::shared_ptr<QueuedJob>& job, std::span<const WheelOrder> wheel_orders)
+{
+	// Greek rotor positions within the job's search space
+	std::vector<SearchSpace> slices;
+	if(job->menu.numRotors() == 4)
+	{
+		for(Letter position = 0; position < NUM_LETTERS; ++position)
+		{
+			if(job->search_space.positions[0].test(position))
+			{
+				auto& slice = slices.emplace_back(job->search_space);
+				slice.positions[0].reset().set(position);
+			}
+		}
+	}
+	else
+	{
+		slices.push_back(job->search_space);
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		job->num_pending = wheel_orders.size() * slices.size();
+		// The job's units take one round each, starting with the round in progress at its priority
+		uint64_t round = rounds_[job->priority];
+		for(const auto& wheel_order : wheel_orders)
+		{
+			for(const auto& slice : slices)
+			{
+				units_.push({job->priority, round++, job->id, {job, wheel_order, slice}});
+			}
+		}
+	}
+	condition_.notify_all();
+}
+
+std::optional<JobQueue::Unit> JobQueue::pop()
+{
+	std::unique_lock lock(mutex_);
+	for(;;)
+	{
+		condition_.wait(lock, [this] { return closed_ || !units_.empty(); });
+		if(closed_)
+		{
+			return std::nullopt;
+		}
+		const Entry& entry = units_.top();
+		Unit unit = entry.unit;
+		if(!unit.job->cancelled)
+		{
+			rounds_[entry.priority] = entry.round;
+			units_.pop();
+			return unit;
+		}
+		units_.pop();
+		--unit.job->num_pending;
+	}
+}
+
+void JobQueue::close()
+{
+	std::priority_queue<Entry> dropped;
+	{
+		std::lock_guard lock(mutex_);
+		closed_ = true;
+		dropped.swap(units_);
+	}
+	condition_.notify_all();
+	for(; !dropped.empty(); dropped.pop())
+	{
+		dropped.top().unit.job->cancelled = true;
+	}
+}
+
+size_t JobQueue::size() const
+{
+	std::lock_guard lock(mutex_);
+	return units_.size();
+}
+
+} // namespace bombe
@@ -0,0 +1,81 @@
+#ifndef BOMBE_JOB_QUEUE_H
+#define BOMBE_JOB_QUEUE_H
+
+#include "bombe.h"
+#include "wheel_orders.h"
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+namespace bombe {
+
+// A menu to be swept over a set of wheel orders, as queued by JobQueue. Users derive their own job state from it.
+struct QueuedJob
+{
+	uint64_t id{0};
+	int priority{0};
+	Bombe::Menu menu;
+	SearchSpace search_space;
+
+	std::atomic<size_t> num_pending{0}; // work units not finished yet
+	std::atomic<bool> cancelled{false};
+
+	virtual ~QueuedJob() = default;
+};
+
+// Work units are wheel orders, or for M4 single Greek rotor positions of a wheel order, so a higher priority job
+// overtakes a long sweep after the units in progress (a fraction of a second each). Jobs of equal priority take turns,
+// also with jobs queued while others are half done.
+class JobQueue
+{
+public:
+	struct Unit
+	{
+		std::shared_ptr<QueuedJob> job;
+		WheelOrder wheel_order;
+		SearchSpace search_space;
+	};
+
+	// Queue the units of a job and set its pending count
+	void push(const std::shared_ptr<QueuedJob>& job, std::span<const WheelOrder> wheel_orders);
+
+	// Highest priority unit, or nothing once closed. Units of cancelled jobs are skipped (and counted as finished).
+	std::optional<Unit> pop();
+
+	// Drop queued units (cancelling their jobs) and release the workers
+	void close();
+
+	size_t size() const;
+
+private:
+	// Highest priority first, then the earliest round, then the oldest job
+	struct Entry
+	{
+		int priority;
+		uint64_t round;
+		uint64_t job_id;
+		Unit unit;
+
+		bool operator<(const Entry& other) const
+		{
+			if(priority != other.priority)
+			{
+				return priority < other.priority;
+			}
+			return (round != other.round) ? (round > other.round) : (job_id > other.job_id);
+		}
+	};
+
+	mutable std::mutex mutex_;
+	std::condition_variable condition_;
+	std::priority_queue<Entry> units_;
+	std::map<int, uint64_t> rounds_; // per priority, the round of the last unit popped
+	bool closed_{false};
+};
+
+} // namespace bombe
+
+#endif // BOMBE_JOB_QUEUE_H
@@ -0,0 +1,209 @@
+#include "loop_index.h"
+
+#include <deque>
+#include <numeric>
+
+namespace bombe {
+
+namespace {
+
+// Add offsets to base rotor positions, giving the encoded result
+uint32_t offsetPositions(std::span<const Letter> base, std::span<const Letter> offsets)
+{
+	const DoubleMap& null_map = nullDoubleMap();
+	uint32_t position_index = 0;
+	for(size_t k = 0; k < base.size(); ++k)
+	{
+		position_index = position_index * NUM_LETTERS + null_map[base[k] + offsets[k]];
+	}
+	return position_index;
+}
+
+} // anonymous namespace
+
+std::vector<std::vector<uint32_t>> findRegisterLoops(const Bombe::Menu& menu)
+{
+	// Breadth-first spanning tree of the register component
+	constexpr uint32_t NO_EDGE = UINT32_MAX;
+	std::array<uint32_t, NUM_LETTERS> parent_edges;
+	parent_edges.fill(NO_EDGE);
+	std::array<bool, NUM_LETTERS> reached{};
+	std::vector<bool> tree_edges(menu.edges.size());
+	std::deque<Letter> queue;
+	const Letter reg_letter = menu.registers[0].first;
+	reached[reg_letter] = true;
+	queue.push_back(reg_letter);
+	while(!queue.empty())
+	{
+		const Letter letter = queue.front();
+		queue.pop_front();
+		for(uint32_t edge_idx = 0; edge_idx < menu.edges.size(); ++edge_idx)
+		{
+			const auto [l1, l2] = menu.edges[edge_idx].nodes;
+			const Letter other = (l1 == letter) ? l2 : ((l2 == letter) ? l1 : letter);
+			if(!reached[other])
+			{
+				reached[other] = true;
+				parent_edges[other] = edge_idx;
+				tree_edges[edge_idx] = true;
+				queue.push_back(other);
+			}
+		}
+	}
+
+	// Edges from the register down to a letter
+	const auto path_from_register = [&](Letter letter) {
+		std::vector<uint32_t> path;
+		for(; parent_edges[letter] != NO_EDGE;)
+		{
+			const uint32_t edge_idx = parent_edges[letter];
+			path.push_back(edge_idx);
+			const auto [l1, l2] = menu.edges[edge_idx].nodes;
+			letter = (l1 == letter) ? l2 : l1;
+		}
+		std::reverse(path.begin(), path.end());
+		return path;
+	};
+
+	// Every non-tree edge closes one loop
+	std::vector<std::vector<uint32_t>> loops;
+	for(uint32_t edge_idx = 0; edge_idx < menu.edges.size(); ++edge_idx)
+	{
+		const auto [l1, l2] = menu.edges[edge_idx].nodes;
+		if(tree_edges[edge_idx] || !reached[l1])
+		{
+			continue;
+		}
+
+		auto& loop = loops.emplace_back(path_from_register(l1));
+		loop.push_back(edge_idx);
+		const auto back_path = path_from_register(l2);
+		loop.insert(loop.end(), back_path.rbegin(), back_path.rend());
+	}
+	return loops;
+}
+
+LoopIndex::LoopIndex(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
+	: num_rotors_{rotor_models.size()}
+	, num_positions_{numPositions(rotor_models.size())}
+	, maps_(num_positions_)
+{
+	// Step through all positions like the bombe, updating only the rotors that moved
+	Scrambler scrambler(reflector_model, rotor_models);
+	std::array<Letter, MAX_ROTORS> positions{};
+	size_t first_moved = 0;
+	for(uint32_t position_index = 0; position_index < num_positions_; ++position_index)
+	{
+		for(size_t k = first_moved; k < num_rotors_; ++k)
+		{
+			scrambler.setRotorPosition(k, positions[k]);
+		}
+		std::copy(scrambler.map().begin(), scrambler.map().begin() + NUM_LETTERS, maps_[position_index].begin());
+
+		for(first_moved = num_rotors_; first_moved-- > 0;)
+		{
+			if(++positions[first_moved] < NUM_LETTERS)
+			{
+				break;
+			}
+			positions[first_moved] = 0;
+		}
+	}
+}
+
+LoopIndex::Signature LoopIndex::signature(const Bombe::Menu& menu, std::span<const uint32_t> loop)
+{
+	const size_t num_rotors = menu.numRotors();
+	const auto& first_positions = menu.edges[loop[0]].rotor_positions;
+	Signature signature;
+	signature.reserve(num_rotors * loop.size());
+	for(const auto edge_idx : loop)
+	{
+		const auto& positions = menu.edges[edge_idx].rotor_positions;
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			signature.push_back(static_cast<Letter>((positions[k] + NUM_LETTERS - first_positions[k]) % NUM_LETTERS));
+		}
+	}
+	return signature;
+}
+
+std::span<const uint32_t> LoopIndex::fixedPoints(const Signature& signature)
+{
+	if(const auto it = fixed_points_.find(signature); it != fixed_points_.end())
+	{
+		return it->second;
+	}
+	if((signature.size() % num_rotors_) != 0)
+	{
+		throw std::invalid_argument("Loop signature does not match the wheel order");
+	}
+
+	const size_t loop_size = signature.size() / num_rotors_;
+	auto& fixed_points = fixed_points_[signature];
+	fixed_points.resize(num_positions_);
+	std::array<Letter, MAX_ROTORS> positions;
+	const auto base = std::span(positions).first(num_rotors_);
+	for(uint32_t position_index = 0; position_index < num_positions_; ++position_index)
+	{
+		decodePositions(position_index, base);
+
+		// Follow every letter around the loop
+		SingleMap loop_map;
+		std::iota(loop_map.begin(), loop_map.end(), Letter(0));
+		for(size_t edge = 0; edge < loop_size; ++edge)
+		{
+			const auto edge_offsets = std::span(signature).subspan(edge * num_rotors_, num_rotors_);
+			const auto& map = maps_[offsetPositions(base, edge_offsets)];
+			for(auto& letter : loop_map)
+			{
+				letter = map[letter];
+			}
+		}
+
+		uint32_t mask = 0;
+		for(Letter letter = 0; letter < NUM_LETTERS; ++letter)
+		{
+			mask |= uint32_t(loop_map[letter] == letter) << letter;
+		}
+		fixed_points[position_index] = mask;
+	}
+	return fixed_points;
+}
+
+std::vector<uint32_t> LoopIndex::candidates(const Bombe::Menu& menu)
+{
+	if(menu.numRotors() != num_rotors_)
+	{
+		throw std::invalid_argument("Bombe menu does not match the wheel order");
+	}
+
+	std::vector<uint32_t> common_fixed_points(num_positions_, (1u << NUM_LETTERS) - 1);
+	std::array<Letter, MAX_ROTORS> offsets;
+	const auto rotor_offsets = std::span(offsets).first(num_rotors_);
+	for(const auto& loop : findRegisterLoops(menu))
+	{
+		const auto fixed_points = fixedPoints(signature(menu, loop));
+		const auto& first_positions = menu.edges[loop[0]].rotor_positions;
+		for(uint32_t offset_index = 0; offset_index < num_positions_; ++offset_index)
+		{
+			if(common_fixed_points[offset_index] != 0)
+			{
+				decodePositions(offset_index, rotor_offsets);
+				common_fixed_points[offset_index] &= fixed_points[offsetPositions(first_positions, rotor_offsets)];
+			}
+		}
+	}
+
+	std::vector<uint32_t> candidate_offsets;
+	for(uint32_t offset_index = 0; offset_index < num_positions_; ++offset_index)
+	{
+		if(common_fixed_points[offset_index] != 0)
+		{
+			candidate_offsets.push_back(offset_index);
+		}
+	}
+	return candidate_offsets;
+}
+
+} // namespace bombe
@@ -0,0 +1,46 @@
+#ifndef BOMBE_LOOP_INDEX_H
+#define BOMBE_LOOP_INDEX_H
+
+#include "bombe.h"
+
+#include <map>
+
+namespace bombe {
+
+// Closed walks through the menu starting and ending at the register letter, as menu edge indices: one per
+// independent loop of the register's component (a fundamental cycle, reached along a shortest path).
+std::vector<std::vector<uint32_t>> findRegisterLoops(const Bombe::Menu& menu);
+
+// Loop fixed points of one wheel order, independent of the steckers.
+// At a bombe stop, the stecker partner of the register letter (or, when 25 wires are live, the one dead wire) is
+// mapped to itself by every closed walk from the register, so all register loops share a fixed point. The index
+// tabulates the fixed points of each loop over all rotor positions and intersects them, leaving only candidate
+// positions for full propagation.
+class LoopIndex
+{
+public:
+	// Rotor positions of the loop edges relative to the first edge, which identify a loop at any base position
+	using Signature = std::vector<Letter>;
+
+	LoopIndex(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
+
+	static Signature signature(const Bombe::Menu& menu, std::span<const uint32_t> loop);
+
+	// Fixed points of the loop permutation (bit per letter, in the frame of the loop's first letter), indexed by the
+	// encoded rotor positions of the loop's first edge. Tabulated on first use.
+	std::span<const uint32_t> fixedPoints(const Signature& signature);
+
+	// Encoded rotor offsets from the menu positions (as in Bombe::test()) at which all register loops have a common
+	// fixed point, in ascending order. Every bombe stop is among them.
+	std::vector<uint32_t> candidates(const Bombe::Menu& menu);
+
+private:
+	size_t num_rotors_;
+	uint32_t num_positions_;
+	std::vector<SingleMap> maps_; // scrambler map at each encoded rotor position
+	std::map<Signature, std::vector<uint32_t>> fixed_points_;
+};
+
+} // namespace bombe
+
+#endif // BOMBE_LOOP_INDEX_H
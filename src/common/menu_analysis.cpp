@@ -0,0 +1,156 @@
+#include "menu_analysis.h"
+
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace bombe {
+
+namespace {
+
+struct LetterSets
+{
+	std::array<Letter, NUM_LETTERS> parents;
+
+	LetterSets()
+	{
+		std::iota(parents.begin(), parents.end(), Letter(0));
+	}
+
+	Letter find(Letter letter)
+	{
+		while(parents[letter] != letter)
+		{
+			parents[letter] = parents[parents[letter]];
+			letter = parents[letter];
+		}
+		return letter;
+	}
+
+	void join(Letter l1, Letter l2)
+	{
+		parents[find(l1)] = find(l2);
+	}
+};
+
+} // anonymous namespace
+
+MenuStatistics analyzeMenu(const Bombe::Menu& menu)
+{
+	MenuStatistics statistics{};
+	statistics.num_rotors = menu.numRotors();
+	statistics.num_edges = menu.edges.size();
+
+	std::array<bool, NUM_LETTERS> used{};
+	LetterSets sets;
+	for(const auto& edge : menu.edges)
+	{
+		used[edge.nodes.first] = true;
+		used[edge.nodes.second] = true;
+		sets.join(edge.nodes.first, edge.nodes.second);
+	}
+	const Letter reg_letter = menu.registers[0].first;
+	used[reg_letter] = true;
+
+	const Letter reg_root = sets.find(reg_letter);
+	for(Letter letter = 0; letter < NUM_LETTERS; ++letter)
+	{
+		if(used[letter])
+		{
+			++statistics.num_letters;
+			statistics.num_components += (sets.find(letter) == letter) ? 1 : 0;
+			statistics.register_letters += (sets.find(letter) == reg_root) ? 1 : 0;
+		}
+	}
+	for(const auto& edge : menu.edges)
+	{
+		statistics.register_edges += (sets.find(edge.nodes.first) == reg_root) ? 1 : 0;
+	}
+
+	statistics.num_closures = statistics.num_edges + statistics.num_components - statistics.num_letters;
+	statistics.register_closures = statistics.register_edges + 1 - statistics.register_letters;
+	return statistics;
+}
+
+double estimateFalseStops(const MenuStatistics& statistics)
+{
+	const double n = NUM_LETTERS;
+	const double loop_pass = std::pow(1 / n, static_cast<double>(statistics.register_closures));
+	const double letter_pass = 1 - (statistics.num_letters - 1) / n * (n - 1) / n;
+	const double diagonal_pass = std::pow(letter_pass, static_cast<double>(statistics.register_letters));
+	const double surviving_hypotheses = n * loop_pass * diagonal_pass;
+	return numPositions(statistics.num_rotors) * std::min(1.0, surviving_hypotheses);
+}
+
+double StopRateSample::stopsPerWheelOrder(size_t num_rotors) const
+{
+	return (num_positions == 0) ? 0 : (double(num_stops) / num_positions * numPositions(num_rotors));
+}
+
+double StopRateSample::stopsPerWheelOrderUpperBound(size_t num_rotors) const
+{
+	if(num_positions == 0)
+	{
+		return double(numPositions(num_rotors));
+	}
+	// Poisson: 3 events for no observed stop, otherwise a normal approximation
+	const double n = static_cast<double>(num_stops);
+	const double upper = (num_stops == 0) ? 3.0 : (n + 1.96 * std::sqrt(n) + 1);
+	return std::min(1.0, upper / num_positions) * numPositions(num_rotors);
+}
+
+StopRateSample sampleStopRate(const Bombe::Menu& menu,
+                              ReflectorModel reflector_model,
+                              std::span<const RotorModel> rotor_models,
+                              uint64_t num_positions,
+                              size_t num_threads,
+                              uint64_t seed)
+{
+	num_threads = std::max<size_t>(num_threads, 1);
+	std::vector<StopRateSample> samples(num_threads);
+	std::vector<double> seconds(num_threads);
+	const auto worker = [&](size_t thread_idx) {
+		Bombe my_bombe(menu, reflector_model, rotor_models);
+		std::mt19937_64 rng(seed + thread_idx);
+		std::uniform_int_distribution<int> letter_distribution(0, NUM_LETTERS - 1);
+		std::array<Letter, MAX_ROTORS> rotor_offsets{};
+		auto& sample = samples[thread_idx];
+		sample.num_positions = num_positions / num_threads + ((thread_idx < num_positions % num_threads) ? 1 : 0);
+
+		const auto tic = std::chrono::steady_clock::now();
+		for(uint64_t k = 0; k < sample.num_positions; ++k)
+		{
+			for(size_t r = 0; r < rotor_models.size(); ++r)
+			{
+				rotor_offsets[r] = static_cast<Letter>(letter_distribution(rng));
+			}
+			sample.num_stops += my_bombe.test(std::span(rotor_offsets).first(rotor_models.size())) ? 1 : 0;
+		}
+		seconds[thread_idx] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tic).count();
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+	{
+		threads.emplace_back(worker, thread_idx);
+	}
+	worker(0);
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	StopRateSample total{};
+	for(const auto& sample : samples)
+	{
+		total.num_positions += sample.num_positions;
+		total.num_stops += sample.num_stops;
+	}
+	const double total_seconds = std::accumulate(seconds.begin(), seconds.end(), 0.0);
+	total.seconds_per_position = (total.num_positions == 0) ? 0 : (total_seconds / total.num_positions);
+	return total;
+}
+
+} // namespace bombe
@@ -0,0 +1,55 @@
+#ifndef BOMBE_MENU_ANALYSIS_H
+#define BOMBE_MENU_ANALYSIS_H
+
+#include "bombe.h"
+
+namespace bombe {
+
+// Graph structure of a bombe menu (letters are nodes, scramblers are edges)
+struct MenuStatistics
+{
+	size_t num_rotors;
+	size_t num_letters;
+	size_t num_edges;
+	size_t num_components;
+	size_t num_closures; // independent loops: edges - letters + components
+
+	// The component holding the register letter; only its loops can reject a stecker hypothesis
+	size_t register_letters;
+	size_t register_edges;
+	size_t register_closures;
+};
+
+MenuStatistics analyzeMenu(const Bombe::Menu& menu);
+
+// Analytic estimate of stops per wheel order. Each closure in the register component passes a wrong stecker
+// hypothesis with probability 1/26. On top of that, the diagonal board rejects the hypothesis when the stecker partner
+// implied for a register component letter is another menu letter (which feeds a second voltage back into the menu),
+// unless that partner happens to be implied consistently. Only an order of magnitude; see sampleStopRate().
+double estimateFalseStops(const MenuStatistics& statistics);
+
+struct StopRateSample
+{
+	uint64_t num_positions;
+	uint64_t num_stops;
+	double seconds_per_position; // measured bombe cost per tested position, per thread
+
+	// Stops per wheel order, extrapolated from the sampled rate
+	double stopsPerWheelOrder(size_t num_rotors) const;
+
+	// Approximate 95% upper bound of stopsPerWheelOrder(), also meaningful when no stop was sampled
+	double stopsPerWheelOrderUpperBound(size_t num_rotors) const;
+};
+
+// Monte Carlo stop rate: test num_positions uniformly random positions of the given wheel order, split over
+// num_threads bombes. Results are reproducible for a given seed and thread count.
+StopRateSample sampleStopRate(const Bombe::Menu& menu,
+                              ReflectorModel reflector_model,
+                              std::span<const RotorModel> rotor_models,
+                              uint64_t num_positions,
+                              size_t num_threads,
+                              uint64_t seed);
+
+} // namespace bombe
+
+#endif // BOMBE_MENU_ANALYSIS_H
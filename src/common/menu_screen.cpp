@@ -0,0 +1,112 @@
+#include "menu_screen.h"
+#include "loop_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace bombe {
+
+Bombe::Menu selectScreenMenu(const Bombe::Menu& menu)
+{
+	Bombe::Menu screen_menu;
+	screen_menu.registers = menu.registers;
+	auto loops = findRegisterLoops(menu);
+	if(loops.size() < 2)
+	{
+		return screen_menu;
+	}
+
+	// Short loops close within few edges
+	std::stable_sort(loops.begin(), loops.end(), [](const auto& loop1, const auto& loop2) {
+		return loop1.size() < loop2.size();
+	});
+	std::vector<bool> selected(menu.edges.size());
+	for(size_t loop_idx = 0; loop_idx < 2; ++loop_idx)
+	{
+		for(const uint32_t edge_idx : loops[loop_idx])
+		{
+			selected[edge_idx] = true;
+		}
+	}
+	for(size_t edge_idx = 0; edge_idx < menu.edges.size(); ++edge_idx)
+	{
+		if(selected[edge_idx])
+		{
+			screen_menu.edges.push_back(menu.edges[edge_idx]);
+		}
+	}
+	return screen_menu;
+}
+
+MenuScreen::MenuScreen(const Bombe::Menu& menu,
+                       ReflectorModel reflector_model,
+                       std::span<const RotorModel> rotor_models)
+	: menu_{menu}
+	, screen_menu_{selectScreenMenu(menu)}
+{
+	if(active())
+	{
+		screen_bombe_.emplace(screen_menu_, reflector_model, rotor_models);
+		screen_bombe_->setScreening(true);
+	}
+}
+
+void MenuScreen::reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
+{
+	if(screen_bombe_)
+	{
+		screen_bombe_->reconfigure(reflector_model, rotor_models);
+	}
+}
+
+void MenuScreen::setSearchSpace(const SearchSpace& search_space)
+{
+	if(!screen_bombe_)
+	{
+		return;
+	}
+
+	// The search space is given at the rotor positions of the menu's first edge; the screen bombe takes it at those of
+	// the sub-menu's first edge, so both allow the same rotor offsets
+	SearchSpace screen_space;
+	for(size_t k = 0; k < menu_.numRotors(); ++k)
+	{
+		const Letter shift = static_cast<Letter>(
+			(menu_.edges[0].rotor_positions[k] + NUM_LETTERS - screen_menu_.edges[0].rotor_positions[k]) % NUM_LETTERS);
+		for(Letter position = 0; position < NUM_LETTERS; ++position)
+		{
+			screen_space.positions[k][position] = search_space.positions[k][(position + shift) % NUM_LETTERS];
+		}
+	}
+	screen_bombe_->setSearchSpace(screen_space);
+}
+
+std::vector<uint32_t> MenuScreen::candidates()
+{
+	const size_t num_rotors = menu_.numRotors();
+	std::vector<uint32_t> result;
+	if(!screen_bombe_)
+	{
+		// Bombe::runPositions() applies its own search space
+		result.resize(numPositions(num_rotors));
+		std::iota(result.begin(), result.end(), 0);
+		return result;
+	}
+
+	// Reports are at the rotor positions of the sub-menu's first edge, which all edges share as offsets
+	const auto& first_positions = screen_menu_.edges[0].rotor_positions;
+	std::array<Letter, MAX_ROTORS> offsets;
+	const auto rotor_offsets = std::span(offsets).first(num_rotors);
+	for(const auto& report : screen_bombe_->run())
+	{
+		decodePositions(report.position_index, rotor_offsets);
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			rotor_offsets[k] = static_cast<Letter>((rotor_offsets[k] + NUM_LETTERS - first_positions[k]) % NUM_LETTERS);
+		}
+		result.push_back(encodePositions(rotor_offsets));
+	}
+	return result;
+}
+
+} // namespace bombe
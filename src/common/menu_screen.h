@@ -0,0 +1,51 @@
+#ifndef BOMBE_MENU_SCREEN_H
+#define BOMBE_MENU_SCREEN_H
+
+#include "bombe.h"
+
+namespace bombe {
+
+// Sub-menu for screening: the edges of the two shortest register loops (see findRegisterLoops()), in menu order, with
+// all registers. Without the diagonal board, a single loop rejects almost nothing, so the sub-menu has no edges when
+// the register has fewer than two loops.
+Bombe::Menu selectScreenMenu(const Bombe::Menu& menu);
+
+// First stage of a cascade: a screening bombe (Bombe::setScreening()) over the sub-menu sweeps all positions, and only
+// the positions it passes need full propagation, with all edges and the diagonal board (Bombe::runPositions()). Most
+// positions are rejected after a few edges of the sub-menu, and the stops are those of a full run. Like the loop
+// screen, it covers the menu as written (no turnover hypotheses).
+class MenuScreen
+{
+public:
+	MenuScreen(const Bombe::Menu& menu, ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
+
+	// Whether the menu has a sub-menu to screen with; otherwise candidates() passes every position
+	bool active() const
+	{
+		return !screen_menu_.edges.empty();
+	}
+
+	const Bombe::Menu& screenMenu() const
+	{
+		return screen_menu_;
+	}
+
+	// As Bombe::reconfigure()
+	void reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
+
+	// Positions as in Bombe::setSearchSpace() for the full menu (default: all positions)
+	void setSearchSpace(const SearchSpace& search_space);
+
+	// Encoded rotor offsets from the menu positions (as in Bombe::test()) passed by the screen, in the order of
+	// Bombe::run(). Every stop of the full menu is among them.
+	std::vector<uint32_t> candidates();
+
+private:
+	const Bombe::Menu& menu_;
+	Bombe::Menu screen_menu_;
+	std::optional<Bombe> screen_bombe_;
+};
+
+} // namespace bombe
+
+#endif // BOMBE_MENU_SCREEN_H
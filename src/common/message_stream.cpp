@@ -0,0 +1,87 @@
+#include "message_stream.h"
+
+namespace bombe {
+
+MessageStream::MessageStream(Enigma& enigma, KeyHandler key_handler, Writer writer, size_t buffer_size)
+	: enigma_{enigma}
+	, key_handler_{std::move(key_handler)}
+	, writer_{std::move(writer)}
+	, letters_(buffer_size)
+	, output_(buffer_size)
+{
+	if(buffer_size == 0)
+	{
+		throw std::invalid_argument("Empty message stream buffer");
+	}
+}
+
+void MessageStream::feed(std::string_view input)
+{
+	for(const char ch : input)
+	{
+		if(in_key_line_)
+		{
+			if(ch == '\n')
+			{
+				applyKeyLine();
+			}
+			else
+			{
+				key_line_.push_back(ch);
+			}
+		}
+		else if(line_start_ && (ch == '@'))
+		{
+			key_line_.clear();
+			in_key_line_ = true;
+		}
+		else
+		{
+			line_start_ = (ch == '\n');
+			if((ch != ' ') && (ch != '\n') && (ch != '\r'))
+			{
+				letters_[num_letters_++] = ch;
+				if(num_letters_ == letters_.size())
+				{
+					flush();
+				}
+			}
+		}
+	}
+	flush();
+}
+
+void MessageStream::finish()
+{
+	if(in_key_line_)
+	{
+		applyKeyLine();
+	}
+	flush();
+}
+
+void MessageStream::flush()
+{
+	if(num_letters_ > 0)
+	{
+		enigma_.process({letters_.data(), num_letters_}, {output_.data(), num_letters_});
+		writer_({output_.data(), num_letters_});
+		num_letters_ = 0;
+		message_started_ = true;
+	}
+}
+
+void MessageStream::applyKeyLine()
+{
+	flush();
+	if(message_started_)
+	{
+		writer_("\n");
+		message_started_ = false;
+	}
+	key_handler_(key_line_, enigma_);
+	in_key_line_ = false;
+	line_start_ = true;
+}
+
+} // namespace bombe
@@ -0,0 +1,50 @@
+#ifndef BOMBE_MESSAGE_STREAM_H
+#define BOMBE_MESSAGE_STREAM_H
+
+#include "enigma.h"
+
+#include <functional>
+#include <string>
+
+namespace bombe {
+
+// Several messages streamed through an Enigma in fixed-size buffers. Spaces and line breaks are dropped, and a line
+// starting with '@' carries the key of the next message, whose output starts on a new line. Input can be fed in chunks
+// of any size, split anywhere.
+class MessageStream
+{
+public:
+	// Applies a key line (without the '@') to the machine
+	using KeyHandler = std::function<void(std::string_view key_line, Enigma& enigma)>;
+
+	// Receives the processed text
+	using Writer = std::function<void(std::string_view text)>;
+
+	MessageStream(Enigma& enigma, KeyHandler key_handler, Writer writer, size_t buffer_size = 1 << 16);
+
+	void feed(std::string_view input);
+
+	// End of input: process the buffered letters, and apply a last key line that has no line break
+	void finish();
+
+private:
+	void flush();
+
+	void applyKeyLine();
+
+private:
+	Enigma& enigma_;
+	KeyHandler key_handler_;
+	Writer writer_;
+	std::vector<char> letters_;
+	std::vector<char> output_;
+	size_t num_letters_{0};
+	std::string key_line_;
+	bool in_key_line_{false};
+	bool line_start_{true};
+	bool message_started_{false};
+};
+
+} // namespace bombe
+
+#endif // BOMBE_MESSAGE_STREAM_H
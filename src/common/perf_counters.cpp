@@ -0,0 +1,164 @@
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#	include <linux/perf_event.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+namespace bombe {
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other)
+{
+	task_clock_ns += other.task_clock_ns;
+	cycles += other.cycles;
+	instructions += other.instructions;
+	l1d_misses += other.l1d_misses;
+	llc_misses += other.llc_misses;
+	branch_misses += other.branch_misses;
+	return *this;
+}
+
+PerfCounts PerfCounts::operator-(const PerfCounts& other) const
+{
+	return {task_clock_ns - other.task_clock_ns,
+	        cycles - other.cycles,
+	        instructions - other.instructions,
+	        l1d_misses - other.l1d_misses,
+	        llc_misses - other.llc_misses,
+	        branch_misses - other.branch_misses};
+}
+
+PerfCounters::PerfCounters()
+{
+	fds_.fill(-1);
+#ifdef __linux__
+	struct Event
+	{
+		uint32_t type;
+		uint64_t config;
+		Field field;
+	};
+	// A hardware leader if possible; the task clock also works where hardware counters are not exposed
+	const std::array<Event, NUM_EVENTS> events = {{
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, &PerfCounts::cycles},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, &PerfCounts::instructions},
+		{PERF_TYPE_HW_CACHE,
+		 PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		 &PerfCounts::l1d_misses},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, &PerfCounts::llc_misses},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, &PerfCounts::branch_misses},
+		{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, &PerfCounts::task_clock_ns},
+	}};
+
+	for(const auto& event : events)
+	{
+		perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = event.type;
+		attr.config = event.config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd_, 0));
+		if(fd < 0)
+		{
+			continue;
+		}
+		if(leader_fd_ < 0)
+		{
+			leader_fd_ = fd;
+		}
+		fds_[group_size_] = fd;
+		group_fields_[group_size_] = event.field;
+		++group_size_;
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for(size_t k = 0; k < group_size_; ++k)
+	{
+		close(fds_[k]);
+	}
+#endif
+}
+
+bool PerfCounters::counts(Field field) const
+{
+	for(size_t k = 0; k < group_size_; ++k)
+	{
+		if(group_fields_[k] == field)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+PerfCounts PerfCounters::read() const
+{
+	PerfCounts result;
+#ifdef __linux__
+	if(leader_fd_ >= 0)
+	{
+		// PERF_FORMAT_GROUP: number of events, then their values
+		std::array<uint64_t, NUM_EVENTS + 1> values{};
+		const ssize_t size = ::read(leader_fd_, values.data(), (group_size_ + 1) * sizeof(uint64_t));
+		if(size == static_cast<ssize_t>((group_size_ + 1) * sizeof(uint64_t)))
+		{
+			for(size_t k = 0; k < group_size_; ++k)
+			{
+				result.*group_fields_[k] = values[k + 1];
+			}
+		}
+	}
+#endif
+	return result;
+}
+
+PerfProfile& PerfProfile::operator+=(const PerfProfile& other)
+{
+	propagation += other.propagation;
+	stepping += other.stepping;
+	num_positions += other.num_positions;
+	return *this;
+}
+
+std::string formatPerfCounts(const PerfCounts& counts, uint64_t num_positions, const PerfCounters& counters)
+{
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(2);
+	const double positions = static_cast<double>(std::max<uint64_t>(num_positions, 1));
+	const char* separator = "";
+	if(counters.counts(&PerfCounts::cycles) && counters.counts(&PerfCounts::instructions) && (counts.cycles > 0))
+	{
+		oss << "IPC " << double(counts.instructions) / counts.cycles;
+		separator = ", ";
+	}
+	const auto per_position = [&](PerfCounters::Field field, double scale, std::string_view unit) {
+		if(counters.counts(field))
+		{
+			oss << separator << counts.*field * scale / positions << ' ' << unit;
+			separator = ", ";
+		}
+	};
+	per_position(&PerfCounts::task_clock_ns, 1e-3, "us/pos");
+	per_position(&PerfCounts::cycles, 1, "cycles/pos");
+	per_position(&PerfCounts::l1d_misses, 1, "L1D/pos");
+	per_position(&PerfCounts::llc_misses, 1, "LLC/pos");
+	per_position(&PerfCounts::branch_misses, 1, "br-miss/pos");
+	if(!counters.counts(&PerfCounts::cycles))
+	{
+		oss << separator << "no hardware counters";
+	}
+	return oss.str();
+}
+
+} // namespace bombe
@@ -0,0 +1,68 @@
+#ifndef BOMBE_PERF_COUNTERS_H
+#define BOMBE_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace bombe {
+
+// User-mode event counts of one thread
+struct PerfCounts
+{
+	uint64_t task_clock_ns{0};
+	uint64_t cycles{0};
+	uint64_t instructions{0};
+	uint64_t l1d_misses{0};
+	uint64_t llc_misses{0};
+	uint64_t branch_misses{0};
+
+	PerfCounts& operator+=(const PerfCounts& other);
+
+	PerfCounts operator-(const PerfCounts& other) const;
+};
+
+// Counters of the calling thread via perf_event_open (Linux only), read as one group. Events the kernel or CPU does not
+// provide (hardware events are often missing in virtual machines and containers) read as 0 and are reported as such.
+class PerfCounters
+{
+public:
+	using Field = uint64_t PerfCounts::*;
+
+	PerfCounters();
+
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool counts(Field field) const;
+
+	PerfCounts read() const;
+
+private:
+	static constexpr size_t NUM_EVENTS = 6;
+
+	int leader_fd_{-1};
+	std::array<int, NUM_EVENTS> fds_;
+	std::array<Field, NUM_EVENTS> group_fields_{}; // fields in group read order
+	size_t group_size_{0};
+};
+
+// Counts of a bombe run split into the propagation phase and the rotor stepping phase (including stop recording)
+struct PerfProfile
+{
+	PerfCounts propagation;
+	PerfCounts stepping;
+	uint64_t num_positions{0};
+
+	PerfProfile& operator+=(const PerfProfile& other);
+};
+
+// Derived metrics, e.g. "IPC 2.41, 1.52 us/pos, 3120 cycles/pos, 15.2 L1D/pos, 0.01 LLC/pos, 4.8 br-miss/pos"
+std::string formatPerfCounts(const PerfCounts& counts, uint64_t num_positions, const PerfCounters& counters);
+
+} // namespace bombe
+
+#endif // BOMBE_PERF_COUNTERS_H
@@ -1,5 +1,34 @@
 #include "reflector.h"
 
+#include <bitset>
+
+namespace {
+
+constexpr bombe::DoubleMap makeReflectorWiring(std::string_view wiring)
+{
+	bombe::DoubleMap result{};
+	for(size_t pair = 0; pair < (bombe::NUM_LETTERS / 2); ++pair)
+	{
+		const auto l1 = static_cast<bombe::Letter>(wiring[pair * 2] - 'A');
+		const auto l2 = static_cast<bombe::Letter>(wiring[pair * 2 + 1] - 'A');
+		result[l1] = l2;
+		result[l2] = l1;
+	}
+	bombe::extendMap(result);
+	return result;
+}
+
+// REGULAR_B, REGULAR_C, REGULAR_A, THIN_B, THIN_C
+constexpr std::array REFLECTOR_WIRINGS = {
+	makeReflectorWiring("AYBRCUDHEQFSGLIPJXKNMOTZVW"),
+	makeReflectorWiring("AFBVCPDJEIGOHYKRLZMXNWQTSU"),
+	makeReflectorWiring("AEBJCMDZFLGYHXIVKWNROQPUST"),
+	makeReflectorWiring("AEBNCKDQFUGYHWIJLOMPRXSZTV"),
+	makeReflectorWiring("ARBDCOEJFNGTHKIVLMPWQZSXUY"),
+};
+
+} // anonymous namespace
+
 namespace bombe {
 
 ReflectorModel getReflectorModel(bool is_m4, size_t model_number)
@@ -12,46 +41,75 @@ ReflectorModel getReflectorModel(bool is_m4, size_t model_number)
 	return static_cast<ReflectorModel>(model_number);
 }
 
-Reflector::Reflector(ReflectorModel model)
+const DoubleMap& reflectorWiring(ReflectorModel model)
 {
-	std::string_view wiring;
 	switch(model)
 	{
 	case ReflectorModel::REGULAR_B:
-		wiring = "AYBRCUDHEQFSGLIPJXKNMOTZVW";
-		break;
+		return REFLECTOR_WIRINGS[0];
 
 	case ReflectorModel::REGULAR_C:
-		wiring = "AFBVCPDJEIGOHYKRLZMXNWQTSU";
-		break;
+		return REFLECTOR_WIRINGS[1];
 
 	case ReflectorModel::REGULAR_A:
-		wiring = "AEBJCMDZFLGYHXIVKWNROQPUST";
-		break;
+		return REFLECTOR_WIRINGS[2];
 
 	case ReflectorModel::THIN_B:
-		wiring = "AEBNCKDQFUGYHWIJLOMPRXSZTV";
-		break;
+		return REFLECTOR_WIRINGS[3];
 
 	case ReflectorModel::THIN_C:
-		wiring = "ARBDCOEJFNGTHKIVLMPWQZSXUY";
-		break;
+		return REFLECTOR_WIRINGS[4];
+
+	case ReflectorModel::REWIRABLE_D:
+		throw std::invalid_argument("The UKW-D has no fixed wiring");
 
 	default:
 		throw std::invalid_argument("Invalid reflector model");
 	}
+}
 
-	std::array<Letter, NUM_LETTERS> wiring_letters;
-	char2Letter(wiring, wiring_letters);
+DoubleMap parseReflectorWiring(std::string_view pairs)
+{
+	std::string letters;
+	for(const char ch : pairs)
+	{
+		if((ch != ':') && (ch != ' '))
+		{
+			letters.push_back(ch);
+		}
+	}
+	if(letters.size() != NUM_LETTERS)
+	{
+		throw std::invalid_argument("Reflector wiring must have 13 pairs");
+	}
 
+	DoubleMap result{};
+	std::bitset<NUM_LETTERS> wired;
 	for(size_t pair = 0; pair < (NUM_LETTERS / 2); ++pair)
 	{
-		const Letter l1 = wiring_letters[pair * 2];
-		const Letter l2 = wiring_letters[pair * 2 + 1];
-		(*this)[l1] = l2;
-		(*this)[l2] = l1;
+		const Letter l1 = char2Letter(letters[pair * 2]);
+		const Letter l2 = char2Letter(letters[pair * 2 + 1]);
+		if((l1 == l2) || wired.test(l1) || wired.test(l2))
+		{
+			throw std::invalid_argument("Invalid reflector pair " + letters.substr(pair * 2, 2));
+		}
+		wired.set(l1);
+		wired.set(l2);
+		result[l1] = l2;
+		result[l2] = l1;
 	}
-	extendMap(*this);
+	extendMap(result);
+	return result;
+}
+
+Reflector::Reflector(ReflectorModel model)
+	: DoubleMap{reflectorWiring(model)}
+{
+}
+
+Reflector::Reflector(const DoubleMap& wiring)
+	: DoubleMap{wiring}
+{
 }
 
 } // namespace bombe
@@ -5,21 +5,32 @@
 
 namespace bombe {
 
-enum class ReflectorModel
+enum class ReflectorModel : uint8_t
 {
 	REGULAR_B = 1,
 	REGULAR_C = 2,
-	REGULAR_A = 3, // pre-war models only
+	REGULAR_A = 3,   // pre-war models only
+	REWIRABLE_D = 4, // UKW-D, wired in the field (see parseReflectorWiring()); three rotors only
 	THIN_B = 101,
 	THIN_C = 102,
 };
 
 ReflectorModel getReflectorModel(bool is_m4, size_t model_number);
 
+// Compile-time wiring table of a reflector model (REWIRABLE_D has none)
+const DoubleMap& reflectorWiring(ReflectorModel model);
+
+// Wiring of a rewirable reflector from all 13 pairs, such as "AB:CD:..." (separators as for steckers)
+DoubleMap parseReflectorWiring(std::string_view pairs);
+
 class Reflector : public DoubleMap
 {
 public:
+	Reflector() = default;
+
 	Reflector(ReflectorModel model);
+
+	explicit Reflector(const DoubleMap& wiring);
 };
 
 } // namespace bombe
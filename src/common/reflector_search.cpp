@@ -0,0 +1,371 @@
+#include "reflector_search.h"
+#include "enigma.h"
+
+#include <bit>
+#include <bitset>
+
+namespace bombe {
+
+ReflectorSearch::ReflectorSearch(const Bombe::Menu& menu, std::span<const RotorModel> rotor_models)
+	: menu_{menu}
+	, wheel_order_{encodeWheelOrder(rotor_models)}
+{
+	if((rotor_models.size() != 3) || (menu.numRotors() != 3))
+	{
+		throw std::invalid_argument("The rewirable reflector search needs three rotors");
+	}
+
+	// Half scramblers of all core positions, shared by every edge, position and register partner
+	const DoubleMap& null_map = nullDoubleMap();
+	const std::array wirings = {
+		&rotorWiring(rotor_models[0]), &rotorWiring(rotor_models[1]), &rotorWiring(rotor_models[2])};
+	const uint32_t num_positions = numPositions(3);
+	inward_maps_.resize(num_positions);
+	outward_maps_.resize(num_positions);
+	std::array<Letter, 3> positions;
+	for(uint32_t position_index = 0; position_index < num_positions; ++position_index)
+	{
+		decodePositions(position_index, positions);
+		SingleMap& inward = inward_maps_[position_index];
+		for(Letter in = 0; in < NUM_LETTERS; ++in)
+		{
+			Letter contact = in;
+			for(size_t k = 3; k-- > 0;)
+			{
+				contact = null_map[contact + wirings[k]->inward_map[contact + positions[k]]];
+			}
+			inward[in] = contact;
+			outward_maps_[position_index][contact] = in;
+		}
+	}
+
+	// Only the letters the register reaches take part
+	const Letter register_letter = menu.registers.front().first;
+	std::bitset<NUM_LETTERS> connected;
+	connected.set(register_letter);
+	for(bool grown = true; grown;)
+	{
+		grown = false;
+		for(const auto& edge : menu.edges)
+		{
+			if(connected.test(edge.nodes.first) != connected.test(edge.nodes.second))
+			{
+				connected.set(edge.nodes.first);
+				connected.set(edge.nodes.second);
+				grown = true;
+			}
+		}
+	}
+	for(size_t menu_idx = 0; menu_idx < menu.edges.size(); ++menu_idx)
+	{
+		const auto& edge = menu.edges[menu_idx];
+		if(edge.rotor_positions.size() != 3)
+		{
+			throw std::invalid_argument("Invalid bombe menu");
+		}
+		if(connected.test(edge.nodes.first))
+		{
+			letter_edges_[edge.nodes.first].push_back(static_cast<uint32_t>(edges_.size()));
+			letter_edges_[edge.nodes.second].push_back(static_cast<uint32_t>(edges_.size()));
+			edges_.push_back({edge.nodes.first, edge.nodes.second, static_cast<uint32_t>(menu_idx), nullptr, nullptr});
+		}
+	}
+	for(Letter letter = 0; letter < NUM_LETTERS; ++letter)
+	{
+		if(connected.test(letter))
+		{
+			letters_.push_back(letter);
+		}
+	}
+
+	known_pairs_.fill(NO_PAIR);
+}
+
+void ReflectorSearch::setKnownPairs(std::string_view pairs)
+{
+	// Same syntax as steckers; letters left alone are unknown, as the reflector has no fixed points
+	const SingleMap map = parseSteckers(pairs);
+	for(Letter letter = 0; letter < NUM_LETTERS; ++letter)
+	{
+		known_pairs_[letter] = (map[letter] == letter) ? NO_PAIR : map[letter];
+	}
+}
+
+void ReflectorSearch::setSearchSpace(const SearchSpace& search_space)
+{
+	search_space_ = search_space;
+}
+
+const std::vector<ReflectorSearch::Result>& ReflectorSearch::run()
+{
+	results_.clear();
+	const auto& first_positions = menu_.edges[0].rotor_positions;
+	std::array<Letter, 3> positions;
+	std::array<Letter, 3> rotor_offsets;
+	for(uint32_t position_index = 0; position_index < numPositions(3); ++position_index)
+	{
+		decodePositions(position_index, positions);
+		bool allowed = true;
+		for(size_t k = 0; k < 3; ++k)
+		{
+			allowed = allowed && search_space_.positions[k][positions[k]];
+			rotor_offsets[k] = static_cast<Letter>((positions[k] + NUM_LETTERS - first_positions[k]) % NUM_LETTERS);
+		}
+		if(allowed)
+		{
+			setPosition(rotor_offsets);
+			testPartners(position_index);
+		}
+	}
+	return results_;
+}
+
+const std::vector<ReflectorSearch::Result>& ReflectorSearch::test(std::span<const Letter> rotor_offsets)
+{
+	if(rotor_offsets.size() != 3)
+	{
+		throw std::invalid_argument("Rotor offsets do not match the bombe menu");
+	}
+
+	results_.clear();
+	setPosition(rotor_offsets);
+	std::array<Letter, 3> positions;
+	for(size_t k = 0; k < 3; ++k)
+	{
+		positions[k] = static_cast<Letter>((menu_.edges[0].rotor_positions[k] + rotor_offsets[k]) % NUM_LETTERS);
+	}
+	testPartners(encodePositions(positions));
+	return results_;
+}
+
+void ReflectorSearch::setPosition(std::span<const Letter> rotor_offsets)
+{
+	std::array<Letter, 3> positions;
+	for(auto& edge : edges_)
+	{
+		const auto& menu_positions = menu_.edges[edge.menu_idx].rotor_positions;
+		for(size_t k = 0; k < 3; ++k)
+		{
+			positions[k] = static_cast<Letter>((menu_positions[k] + rotor_offsets[k]) % NUM_LETTERS);
+		}
+		const uint32_t position_index = encodePositions(positions);
+		edge.inward = &inward_maps_[position_index];
+		edge.outward = &outward_maps_[position_index];
+	}
+}
+
+void ReflectorSearch::testPartners(uint32_t position_index)
+{
+	const Letter register_letter = menu_.registers.front().first;
+	for(Letter partner = 0; partner < NUM_LETTERS; ++partner)
+	{
+		Assignment assignment;
+		assignment.steckers.fill(NO_PAIR);
+		assignment.pairs = known_pairs_;
+		num_nodes_ = 0;
+		if(!assign(assignment, register_letter, partner))
+		{
+			continue;
+		}
+
+		const bool consistent = search(assignment);
+		const bool undecided = (num_nodes_ > node_limit_);
+		if(consistent || undecided)
+		{
+			Result& result = results_.emplace_back();
+			result.stop.reflector_model = ReflectorModel::REWIRABLE_D;
+			result.stop.num_rotors = 3;
+			result.stop.wheel_order = wheel_order_;
+			result.stop.position_index = position_index;
+			result.stop.stecker = {register_letter, partner};
+			result.stop.turnover = 0;
+			result.pairs = consistent ? assignment.pairs : known_pairs_;
+			result.undecided = undecided;
+
+			// Twelve pairs leave only one for the last two contacts
+			std::array<Letter, 2> unpaired;
+			size_t num_unpaired = 0;
+			for(Letter contact = 0; (contact < NUM_LETTERS) && (num_unpaired <= 2); ++contact)
+			{
+				if(result.pairs[contact] == NO_PAIR)
+				{
+					if(num_unpaired < 2)
+					{
+						unpaired[num_unpaired] = contact;
+					}
+					++num_unpaired;
+				}
+			}
+			if(num_unpaired == 2)
+			{
+				result.pairs[unpaired[0]] = unpaired[1];
+				result.pairs[unpaired[1]] = unpaired[0];
+			}
+		}
+	}
+}
+
+bool ReflectorSearch::assign(Assignment& assignment, Letter letter, Letter partner) const
+{
+	auto& steckers = assignment.steckers;
+	if(((steckers[letter] != NO_PAIR) || (steckers[partner] != NO_PAIR)) && (steckers[letter] != partner))
+	{
+		return false;
+	}
+	steckers[letter] = partner;
+	steckers[partner] = letter;
+
+	// A stecker pair of two menu letters steckers both
+	const std::array<Letter, 2> steckered = {letter, partner};
+	for(size_t k = 0; k < ((letter == partner) ? 1 : 2); ++k)
+	{
+		for(const uint32_t edge_idx : letter_edges_[steckered[k]])
+		{
+			const Edge& edge = edges_[edge_idx];
+			if((steckers[edge.l1] == NO_PAIR) || (steckers[edge.l2] == NO_PAIR))
+			{
+				continue;
+			}
+
+			auto& pairs = assignment.pairs;
+			const Letter c1 = (*edge.inward)[steckers[edge.l1]];
+			const Letter c2 = (*edge.inward)[steckers[edge.l2]];
+			if(pairs[c1] == c2)
+			{
+				continue;
+			}
+			if((c1 == c2) || (pairs[c1] != NO_PAIR) || (pairs[c2] != NO_PAIR))
+			{
+				return false;
+			}
+			pairs[c1] = c2;
+			pairs[c2] = c1;
+		}
+	}
+	return true;
+}
+
+uint32_t ReflectorSearch::candidates(const Assignment& assignment, Letter letter) const
+{
+	const auto& steckers = assignment.steckers;
+	const auto& pairs = assignment.pairs;
+	uint32_t result = (1u << NUM_LETTERS) - 1;
+	for(Letter partner = 0; partner < NUM_LETTERS; ++partner)
+	{
+		if(steckers[partner] != NO_PAIR)
+		{
+			result &= ~(1u << partner);
+		}
+	}
+
+	for(const uint32_t edge_idx : letter_edges_[letter])
+	{
+		const Edge& edge = edges_[edge_idx];
+		const Letter other = (edge.l1 == letter) ? edge.l2 : edge.l1;
+		if(steckers[other] == NO_PAIR)
+		{
+			continue;
+		}
+
+		// The partner must reach the contact the reflector pairs with the other letter's contact
+		const Letter contact = (*edge.inward)[steckers[other]];
+		uint32_t allowed = 0;
+		if(pairs[contact] != NO_PAIR)
+		{
+			allowed = 1u << (*edge.outward)[pairs[contact]];
+		}
+		else
+		{
+			for(Letter paired = 0; paired < NUM_LETTERS; ++paired)
+			{
+				if((paired != contact) && (pairs[paired] == NO_PAIR))
+				{
+					allowed |= 1u << (*edge.outward)[paired];
+				}
+			}
+		}
+		result &= allowed;
+	}
+	return result;
+}
+
+bool ReflectorSearch::search(Assignment& assignment)
+{
+	if(++num_nodes_ > node_limit_)
+	{
+		return false;
+	}
+
+	// Forced partners first; then branch on the letter with the fewest candidates, which closes loops early
+	Letter branch_letter = NO_PAIR;
+	uint32_t branch_candidates = 0;
+	for(;;)
+	{
+		branch_letter = NO_PAIR;
+		int min_count = NUM_LETTERS + 1;
+		for(const Letter letter : letters_)
+		{
+			if(assignment.steckers[letter] != NO_PAIR)
+			{
+				continue;
+			}
+			bool reached = false;
+			for(const uint32_t edge_idx : letter_edges_[letter])
+			{
+				const Edge& edge = edges_[edge_idx];
+				reached = reached || (assignment.steckers[(edge.l1 == letter) ? edge.l2 : edge.l1] != NO_PAIR);
+			}
+			if(!reached)
+			{
+				continue;
+			}
+
+			const uint32_t letter_candidates = candidates(assignment, letter);
+			const int count = std::popcount(letter_candidates);
+			if(count < min_count)
+			{
+				min_count = count;
+				branch_letter = letter;
+				branch_candidates = letter_candidates;
+			}
+			if(count <= 1)
+			{
+				break;
+			}
+		}
+
+		if(branch_letter == NO_PAIR)
+		{
+			return true; // all connected letters steckered
+		}
+		if(min_count == 0)
+		{
+			return false;
+		}
+		if(min_count > 1)
+		{
+			break;
+		}
+		if(!assign(assignment, branch_letter, static_cast<Letter>(std::countr_zero(branch_candidates))))
+		{
+			return false;
+		}
+	}
+
+	for(uint32_t remaining = branch_candidates; remaining != 0; remaining &= remaining - 1)
+	{
+		Assignment next = assignment;
+		if(assign(next, branch_letter, static_cast<Letter>(std::countr_zero(remaining))) && search(next))
+		{
+			assignment = next;
+			return true;
+		}
+		if(num_nodes_ > node_limit_)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+} // namespace bombe
@@ -0,0 +1,94 @@
+#ifndef BOMBE_REFLECTOR_SEARCH_H
+#define BOMBE_REFLECTOR_SEARCH_H
+
+#include "bombe.h"
+
+namespace bombe {
+
+// Bombe for a rewirable reflector (UKW-D) of unknown wiring, on three-rotor menus. Without the reflector, a menu edge
+// only says that the reflector pairs the contacts its two letters reach through the rotors, so instead of propagating
+// voltage, every stecker partner of the register letter is tested by a backtracking search over the steckers of the
+// menu letters. Each edge between two steckered letters fixes one reflector pair; the steckers must stay an involution
+// and the reflector a fixed-point-free involution (the consistency checks of a diagonal board, for both). A partner
+// stops when the search finds a consistent assignment for all letters connected to the register, and the stop comes
+// with the reflector pairs it deduced.
+class ReflectorSearch
+{
+public:
+	// Unknown pair of a partial reflector wiring
+	static constexpr Letter NO_PAIR = NUM_LETTERS;
+
+	struct Result
+	{
+		Stop stop;       // reflector model REWIRABLE_D
+		SingleMap pairs; // deduced reflector wiring, NO_PAIR where the menu does not reach
+		bool undecided;  // the node limit ended the search, so the stop is not confirmed
+	};
+
+public:
+	ReflectorSearch(const Bombe::Menu& menu, std::span<const RotorModel> rotor_models);
+
+	// Reflector pairs known beforehand, such as "BO" or pairs kept from an earlier wiring (default: none)
+	void setKnownPairs(std::string_view pairs);
+
+	// Restrict run() to the given rotor positions (default: all positions)
+	void setSearchSpace(const SearchSpace& search_space);
+
+	// Search nodes per register partner before it is reported undecided (default: 100000)
+	void setNodeLimit(uint64_t node_limit)
+	{
+		node_limit_ = node_limit;
+	}
+
+	const std::vector<Result>& run();
+
+	// Test a single position, given as rotor offsets from the menu positions (as Bombe::test())
+	const std::vector<Result>& test(std::span<const Letter> rotor_offsets);
+
+private:
+	struct Edge
+	{
+		Letter l1;
+		Letter l2;
+		uint32_t menu_idx;
+		const SingleMap* inward;  // entry contact to reflector contact, through the three rotors
+		const SingleMap* outward; // the inverse
+	};
+
+	struct Assignment
+	{
+		SingleMap steckers; // NO_PAIR where unknown
+		SingleMap pairs;    // reflector pairs, NO_PAIR where unknown
+	};
+
+	void setPosition(std::span<const Letter> rotor_offsets);
+
+	// Test all partners of the register letter at the current position
+	void testPartners(uint32_t position_index);
+
+	// Stecker letter to partner, checking every edge to an already steckered letter
+	bool assign(Assignment& assignment, Letter letter, Letter partner) const;
+
+	// Partners of an unsteckered letter allowed by its edges to steckered letters
+	uint32_t candidates(const Assignment& assignment, Letter letter) const;
+
+	bool search(Assignment& assignment);
+
+private:
+	const Bombe::Menu& menu_;
+	uint16_t wheel_order_;
+	std::vector<SingleMap> inward_maps_;  // per encoded core position
+	std::vector<SingleMap> outward_maps_; // per encoded core position
+	std::vector<Edge> edges_;             // edges connected to the register letter
+	std::vector<Letter> letters_;         // letters connected to the register letter
+	std::array<std::vector<uint32_t>, NUM_LETTERS> letter_edges_;
+	SingleMap known_pairs_;
+	SearchSpace search_space_;
+	uint64_t node_limit_{100000};
+	uint64_t num_nodes_{0};
+	std::vector<Result> results_;
+};
+
+} // namespace bombe
+
+#endif // BOMBE_REFLECTOR_SEARCH_H
@@ -0,0 +1,199 @@
+#include "ring_recovery.h"
+#include "enigma.h"
+
+#include <cmath>
+#include <thread>
+
+namespace bombe {
+
+namespace {
+
+struct Hypothesis
+{
+	Letter middle_ring;
+	Letter fast_ring;
+	std::array<Letter, 3> start_positions; // slow/middle/fast core positions before the first key press
+	double score;
+	std::string plaintext;
+};
+
+// Scrambler maps of all slow/middle/fast core positions (index (slow * 26 + middle) * 26 + fast); an M4 Greek rotor
+// never moves and stays at its stop position
+std::vector<SingleMap> scramblerMaps(ReflectorModel reflector_model,
+                                     std::span<const RotorModel> rotor_models,
+                                     std::span<const Letter> core_positions)
+{
+	const size_t num_rotors = rotor_models.size();
+	const size_t slow_idx = num_rotors - 3;
+	Scrambler scrambler(reflector_model, rotor_models);
+	if(num_rotors == 4)
+	{
+		scrambler.setRotorPosition(0, core_positions[0]);
+	}
+
+	std::vector<SingleMap> maps(NUM_LETTERS * NUM_LETTERS * NUM_LETTERS);
+	auto map_it = maps.begin();
+	for(Letter slow = 0; slow < NUM_LETTERS; ++slow)
+	{
+		scrambler.setRotorPosition(slow_idx, slow);
+		for(Letter middle = 0; middle < NUM_LETTERS; ++middle)
+		{
+			scrambler.setRotorPosition(slow_idx + 1, middle);
+			for(Letter fast = 0; fast < NUM_LETTERS; ++fast)
+			{
+				scrambler.setRotorPosition(slow_idx + 2, fast);
+				std::copy_n(scrambler.map().begin(), NUM_LETTERS, (map_it++)->begin());
+			}
+		}
+	}
+	return maps;
+}
+
+} // anonymous namespace
+
+const std::array<double, NUM_LETTERS>& germanLogProbabilities()
+{
+	static const auto log_probabilities = []() {
+		// Letter frequencies (%) of German military plaintext: X separates words and sentences, and stands for CH
+		// together with Q
+		constexpr std::array<double, NUM_LETTERS> frequencies{
+			6.00, 1.80, 1.50, 4.70, 15.50, 1.60, 2.80, 3.20, 7.00, 0.25, 1.20, 3.30, 2.30,
+			9.00, 2.60, 0.75, 0.60, 7.00, 6.50, 5.80, 4.00, 0.65, 1.70, 5.00, 0.05, 1.10};
+		std::array<double, NUM_LETTERS> result;
+		for(Letter k = 0; k < NUM_LETTERS; ++k)
+		{
+			result[k] = std::log(frequencies[k] / 100);
+		}
+		return result;
+	}();
+	return log_probabilities;
+}
+
+std::vector<RingSettingCandidate> recoverRingSettings(const Stop& stop,
+                                                      size_t position_offset,
+                                                      std::string_view steckers,
+                                                      std::string_view ciphertext,
+                                                      size_t num_results,
+                                                      size_t num_threads)
+{
+	const size_t num_rotors = stop.num_rotors;
+	std::array<RotorModel, MAX_ROTORS> rotor_models;
+	stop.rotorModels(rotor_models);
+	std::array<Letter, MAX_ROTORS> core_positions;
+	stop.rotorPositions(core_positions);
+	const size_t slow_idx = num_rotors - 3;
+
+	const SingleMap stecker_map = parseSteckers(steckers);
+	std::vector<Letter> cipher_letters(ciphertext.size());
+	char2Letter(ciphertext, cipher_letters);
+
+	const auto maps =
+		scramblerMaps(stop.reflector_model, std::span(rotor_models).first(num_rotors), core_positions);
+	const auto& log_probabilities = germanLogProbabilities();
+
+	// The stop positions are those after position_offset + 1 key presses
+	const size_t stop_presses = position_offset + 1;
+	const Letter target_slow = core_positions[slow_idx];
+	const Letter target_middle = core_positions[slow_idx + 1];
+	const Letter target_fast = core_positions[slow_idx + 2];
+	const auto fast_start =
+		static_cast<Letter>((target_fast + NUM_LETTERS - stop_presses % NUM_LETTERS) % NUM_LETTERS);
+
+	num_threads = std::clamp<size_t>(num_threads, 1, NUM_LETTERS);
+	std::vector<std::vector<Hypothesis>> thread_hypotheses(num_threads);
+	const auto worker = [&](size_t thread_idx) {
+		Rotor middle_rotor(rotor_models[slow_idx + 1]);
+		Rotor fast_rotor(rotor_models[slow_idx + 2]);
+		std::string plaintext(cipher_letters.size(), ' ');
+		for(Letter middle_ring = static_cast<Letter>(thread_idx); middle_ring < NUM_LETTERS;
+		    middle_ring = static_cast<Letter>(middle_ring + num_threads))
+		{
+			middle_rotor.setRing(middle_ring);
+			for(Letter fast_ring = 0; fast_ring < NUM_LETTERS; ++fast_ring)
+			{
+				fast_rotor.setRing(fast_ring);
+
+				// Every middle start position that steps to the stop positions (the slow rotor follows along)
+				for(Letter middle_start = 0; middle_start < NUM_LETTERS; ++middle_start)
+				{
+					const SteppingSchedule schedule(
+						{0, middle_start, fast_start}, middle_rotor.turnovers(), fast_rotor.turnovers());
+					const auto stop_positions = schedule.positionsAfter(stop_presses);
+					if(stop_positions[1] != target_middle)
+					{
+						continue;
+					}
+					const auto slow_start =
+						static_cast<Letter>((target_slow + NUM_LETTERS - stop_positions[0]) % NUM_LETTERS);
+
+					double score = 0;
+					for(size_t k = 0; k < cipher_letters.size(); ++k)
+					{
+						const auto positions = schedule.positionsAfter(k + 1);
+						const size_t slow = (positions[0] + slow_start) % NUM_LETTERS;
+						const auto& map = maps[(slow * NUM_LETTERS + positions[1]) * NUM_LETTERS + positions[2]];
+						const Letter letter = stecker_map[map[stecker_map[cipher_letters[k]]]];
+						score += log_probabilities[letter];
+						plaintext[k] = letter2Char(letter);
+					}
+					thread_hypotheses[thread_idx].push_back(
+						{middle_ring, fast_ring, {slow_start, middle_start, fast_start}, score, plaintext});
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+	{
+		threads.emplace_back(worker, thread_idx);
+	}
+	worker(0);
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<Hypothesis> hypotheses;
+	for(auto& thread_results : thread_hypotheses)
+	{
+		std::move(thread_results.begin(), thread_results.end(), std::back_inserter(hypotheses));
+	}
+	std::sort(hypotheses.begin(), hypotheses.end(), [](const Hypothesis& h1, const Hypothesis& h2) {
+		return std::tie(h2.score, h1.middle_ring, h1.fast_ring, h1.start_positions) <
+		       std::tie(h1.score, h2.middle_ring, h2.fast_ring, h2.start_positions);
+	});
+
+	std::vector<RingSettingCandidate> candidates;
+	const double num_letters = std::max<double>(cipher_letters.size(), 1);
+	for(size_t k = 0; (k < hypotheses.size()) && (candidates.size() < num_results); ++k)
+	{
+		const auto& hypothesis = hypotheses[k];
+		const bool is_duplicate = std::any_of(candidates.begin(), candidates.end(), [&](const auto& candidate) {
+			return candidate.plaintext == hypothesis.plaintext;
+		});
+		if(is_duplicate)
+		{
+			continue;
+		}
+
+		RingSettingCandidate candidate{std::string(num_rotors, 'A'), std::string(num_rotors, 'A'),
+		                               hypothesis.score / num_letters, hypothesis.plaintext};
+		candidate.ringstellung[slow_idx + 1] = letter2Char(hypothesis.middle_ring);
+		candidate.ringstellung[slow_idx + 2] = letter2Char(hypothesis.fast_ring);
+		if(num_rotors == 4)
+		{
+			candidate.grundstellung[0] = letter2Char(core_positions[0]);
+		}
+		for(size_t r = 0; r < 3; ++r)
+		{
+			const Letter ring = char2Letter(candidate.ringstellung[slow_idx + r]);
+			candidate.grundstellung[slow_idx + r] =
+				letter2Char(static_cast<Letter>((hypothesis.start_positions[r] + ring) % NUM_LETTERS));
+		}
+		candidates.push_back(std::move(candidate));
+	}
+	return candidates;
+}
+
+} // namespace bombe
@@ -0,0 +1,36 @@
+#ifndef BOMBE_RING_RECOVERY_H
+#define BOMBE_RING_RECOVERY_H
+
+#include "stop.h"
+
+#include <vector>
+
+namespace bombe {
+
+// Message key consistent with a stop, as Enigma::configureRotors() arguments
+struct RingSettingCandidate
+{
+	std::string ringstellung;
+	std::string grundstellung;
+	double score; // average log-likelihood per letter of the plaintext as German text
+	std::string plaintext;
+};
+
+// Ring settings of a confirmed stop. At fixed core positions, the rings only decide when the middle and slow rotors
+// step, so the 26 x 26 middle/fast rings are tried: for each, the start positions are stepped back from the stop
+// positions (those of the message letter at position_offset) and the message is decrypted through a table of the
+// scrambler maps of all positions. The slow (and Greek) rings are irrelevant and reported as 'A'; of equivalent keys
+// (same plaintext) only the one with the lowest rings is kept. Returns the num_results best candidates, best first.
+std::vector<RingSettingCandidate> recoverRingSettings(const Stop& stop,
+                                                      size_t position_offset,
+                                                      std::string_view steckers,
+                                                      std::string_view ciphertext,
+                                                      size_t num_results,
+                                                      size_t num_threads);
+
+// Log-likelihood of each letter in German text
+const std::array<double, NUM_LETTERS>& germanLogProbabilities();
+
+} // namespace bombe
+
+#endif // BOMBE_RING_RECOVERY_H
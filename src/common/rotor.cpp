@@ -1,6 +1,45 @@
 #include "rotor.h"
+#include "rotor_kernels.h"
 
-#include <vector>
+namespace {
+
+using bombe::Letter;
+using bombe::NUM_LETTERS;
+
+constexpr bombe::RotorWiring makeRotorWiring(std::string_view wiring, std::string_view turnovers)
+{
+	bombe::RotorWiring result{};
+	for(Letter l1 = 0; l1 < NUM_LETTERS; ++l1)
+	{
+		const auto l2 = static_cast<Letter>(wiring[l1] - 'A');
+		result.inward_map[l1] = static_cast<Letter>((l2 + NUM_LETTERS - l1) % NUM_LETTERS);
+		result.outward_map[l2] = static_cast<Letter>((l1 + NUM_LETTERS - l2) % NUM_LETTERS);
+	}
+	bombe::extendMap(result.inward_map);
+	bombe::extendMap(result.outward_map);
+
+	for(const char ch : turnovers)
+	{
+		result.turnover_mask |= 1u << (ch - 'A');
+	}
+	return result;
+}
+
+// M_I to M_VIII, followed by M_BETA and M_GAMMA
+constexpr std::array ROTOR_WIRINGS = {
+	makeRotorWiring("EKMFLGDQVZNTOWYHXUSPAIBRCJ", "Q"),
+	makeRotorWiring("AJDKSIRUXBLHWTMCQGZNPYFVOE", "E"),
+	makeRotorWiring("BDFHJLCPRTXVZNYEIWGAKMUSQO", "V"),
+	makeRotorWiring("ESOVPZJAYQUIRHXLNFTGKDCMWB", "J"),
+	makeRotorWiring("VZBRGITYUPSDNHLXAWMJQOFECK", "Z"),
+	makeRotorWiring("JPGVOUMFYQBENHZRDKASXLICTW", "ZM"),
+	makeRotorWiring("NZJHGRCXMYSWBOUFAIVLPEKQDT", "ZM"),
+	makeRotorWiring("FKQHTLXOCBJSPDZRAMEWNIUYGV", "ZM"),
+	makeRotorWiring("LEYJVCNIXWPBQMDRTAKZGFUHOS", ""),
+	makeRotorWiring("FSOKANUERHMBTIYCWLQPZXVGJD", ""),
+};
+
+} // anonymous namespace
 
 namespace bombe {
 
@@ -14,95 +53,31 @@ RotorModel getRotorModel(bool is_thin, size_t model_number)
 	return static_cast<RotorModel>(model_number);
 }
 
-Rotor::Rotor(RotorModel model, const DoubleMap* left_reflector)
-	: left_reflector_{left_reflector}
+const RotorWiring& rotorWiring(RotorModel model)
 {
-	std::string_view wiring;
-	std::string_view turnovers;
-	switch(model)
+	const auto value = static_cast<size_t>(model);
+	if((value >= static_cast<size_t>(RotorModel::M_I)) && (value <= static_cast<size_t>(RotorModel::M_VIII)))
 	{
-	case RotorModel::M_I:
-		wiring = "EKMFLGDQVZNTOWYHXUSPAIBRCJ";
-		turnovers = "Q";
-		break;
-
-	case RotorModel::M_II:
-		wiring = "AJDKSIRUXBLHWTMCQGZNPYFVOE";
-		turnovers = "E";
-		break;
-
-	case RotorModel::M_III:
-		wiring = "BDFHJLCPRTXVZNYEIWGAKMUSQO";
-		turnovers = "V";
-		break;
-
-	case RotorModel::M_IV:
-		wiring = "ESOVPZJAYQUIRHXLNFTGKDCMWB";
-		turnovers = "J";
-		break;
-
-	case RotorModel::M_V:
-		wiring = "VZBRGITYUPSDNHLXAWMJQOFECK";
-		turnovers = "Z";
-		break;
-
-	case RotorModel::M_VI:
-		wiring = "JPGVOUMFYQBENHZRDKASXLICTW";
-		turnovers = "ZM";
-		break;
-
-	case RotorModel::M_VII:
-		wiring = "NZJHGRCXMYSWBOUFAIVLPEKQDT";
-		turnovers = "ZM";
-		break;
-
-	case RotorModel::M_VIII:
-		wiring = "FKQHTLXOCBJSPDZRAMEWNIUYGV";
-		turnovers = "ZM";
-		break;
-
-	case RotorModel::M_BETA:
-		wiring = "LEYJVCNIXWPBQMDRTAKZGFUHOS";
-		turnovers = "";
-		break;
-
-	case RotorModel::M_GAMMA:
-		wiring = "FSOKANUERHMBTIYCWLQPZXVGJD";
-		turnovers = "";
-		break;
-
-	default:
-		throw std::invalid_argument("Invalid rotor model");
+		return ROTOR_WIRINGS[value - static_cast<size_t>(RotorModel::M_I)];
 	}
-
-	turnover_letters_.resize(turnovers.size());
-	char2Letter(turnovers, turnover_letters_);
-
-	std::array<Letter, NUM_LETTERS> wiring_letters;
-	char2Letter(wiring, wiring_letters);
-	const DoubleMap& null_map = nullDoubleMap();
-	for(Letter l1 = 0; l1 < NUM_LETTERS; ++l1)
+	if((value >= static_cast<size_t>(RotorModel::M_BETA)) && (value <= static_cast<size_t>(RotorModel::M_GAMMA)))
 	{
-		const Letter l2 = wiring_letters[l1];
-		inward_map_[l1] = null_map[l2 + NUM_LETTERS - l1];
-		outward_map_[l2] = null_map[l1 + NUM_LETTERS - l2];
+		return ROTOR_WIRINGS[value - static_cast<size_t>(RotorModel::M_BETA) + 8];
 	}
-	extendMap(inward_map_);
-	extendMap(outward_map_);
+	throw std::invalid_argument("Invalid rotor model");
+}
+
+Rotor::Rotor(RotorModel model)
+	: wiring_{&rotorWiring(model)}
+{
+	setRing(0);
 }
 
-void Rotor::setPosition(Letter position)
+void Rotor::setPosition(Letter position, const DoubleMap& left_map)
 {
 	assert(position < NUM_LETTERS);
 	position_ = position;
-
-	const DoubleMap& null_map = nullDoubleMap();
-	for(Letter in = 0; in < NUM_LETTERS; ++in)
-	{
-		const Letter out = (*left_reflector_)[in + inward_map_[in + position_]];
-		(*this)[in] = null_map[out + outward_map_[out + position_]];
-	}
-	extendMap(*this);
+	composeRotorMap(wiring_->inward_map, wiring_->outward_map, position_, left_map, *this);
 }
 
 void Rotor::setRing(Letter ring_position)
@@ -112,9 +87,12 @@ void Rotor::setRing(Letter ring_position)
 
 	const DoubleMap& null_map = nullDoubleMap();
 	turnovers_.reset();
-	for(const Letter m : turnover_letters_)
+	for(Letter m = 0; m < NUM_LETTERS; ++m)
 	{
-		turnovers_.set(null_map[m + NUM_LETTERS - ring_]);
+		if((wiring_->turnover_mask >> m) & 1)
+		{
+			turnovers_.set(null_map[m + NUM_LETTERS - ring_]);
+		}
 	}
 }
 
@@ -4,11 +4,10 @@
 #include "types.h"
 
 #include <bitset>
-#include <vector>
 
 namespace bombe {
 
-enum class RotorModel
+enum class RotorModel : uint8_t
 {
 	M_I = 1,
 	M_II = 2,
@@ -22,21 +21,41 @@ enum class RotorModel
 	M_GAMMA = 102,
 };
 
+inline constexpr size_t MAX_ROTORS = 4;
+
 RotorModel getRotorModel(bool is_thin, size_t model_number);
 
+// Compile-time wiring tables of a rotor model
+struct RotorWiring
+{
+	DoubleMap inward_map;  // right-to-left, as offsets
+	DoubleMap outward_map; // left-to-right, as offsets
+	uint32_t turnover_mask;
+};
+
+const RotorWiring& rotorWiring(RotorModel model);
+
 class Rotor : public DoubleMap
 {
 public:
 	Rotor() = default;
 
-	Rotor(RotorModel model, const DoubleMap* left_reflector);
+	explicit Rotor(RotorModel model);
 
 	Letter position() const
 	{
 		return position_;
 	}
 
-	void setPosition(Letter position);
+	// Compose this rotor at the given position with everything on its left (reflector and left rotors)
+	void setPosition(Letter position, const DoubleMap& left_map);
+
+	// Same as setPosition(), with the composition precomputed by the caller
+	void setComposedPosition(Letter position, const DoubleMap& composed_map)
+	{
+		position_ = position;
+		static_cast<DoubleMap&>(*this) = composed_map;
+	}
 
 	Letter ring() const
 	{
@@ -50,14 +69,16 @@ public:
 		return turnovers_[position_];
 	}
 
+	const std::bitset<NUM_LETTERS>& turnovers() const
+	{
+		return turnovers_;
+	}
+
 private:
-	DoubleMap inward_map_;
-	DoubleMap outward_map_;
-	const DoubleMap* left_reflector_;
+	const RotorWiring* wiring_{nullptr};
 	Letter position_{0};
 	Letter ring_{0};
 	std::bitset<NUM_LETTERS> turnovers_;
-	std::vector<Letter> turnover_letters_;
 };
 
 } // namespace bombe
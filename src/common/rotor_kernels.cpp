@@ -0,0 +1,203 @@
+#include "rotor_kernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#	define BOMBE_X86_KERNELS
+#	include <immintrin.h>
+#endif
+
+namespace {
+
+using bombe::DoubleMap;
+using bombe::Letter;
+using bombe::NUM_LETTERS;
+
+void composeScalar(const DoubleMap& inward_map,
+                   const DoubleMap& outward_map,
+                   Letter position,
+                   const DoubleMap& left_map,
+                   DoubleMap& result)
+{
+	const DoubleMap& null_map = bombe::nullDoubleMap();
+	for(Letter in = 0; in < NUM_LETTERS; ++in)
+	{
+		const Letter out = left_map[in + inward_map[in + position]];
+		result[in] = null_map[out + outward_map[out + position]];
+	}
+	bombe::extendMap(result);
+}
+
+#ifdef BOMBE_X86_KERNELS
+
+// Lanes 26-31 repeat letters 0-5, so every intermediate index stays below 32
+alignas(32) constexpr uint8_t LETTER_LANES[32] = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+                                                  16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 0,  1,  2,  3,  4,  5};
+
+// The kernels load 32 bytes of each 52-byte double map and store 32 bytes of the result before extending it
+static_assert(sizeof(DoubleMap) >= 32);
+
+// Sums of two letters modulo 26: where the sum is below 26, the wrapped difference is the larger one
+__attribute__((target("ssse3"))) inline __m128i mod26(__m128i sum)
+{
+	return _mm_min_epu8(sum, _mm_sub_epi8(sum, _mm_set1_epi8(NUM_LETTERS)));
+}
+
+// 32-entry lookup with 16-entry shuffles: indices 0-15 become 112-127 (bit 7 clear) for the low half and indices
+// 16-31 become 0-15 for the high half; shuffles zero the lanes whose index has bit 7 set
+__attribute__((target("ssse3"))) inline __m128i lookup(__m128i low, __m128i high, __m128i idx)
+{
+	return _mm_or_si128(_mm_shuffle_epi8(low, _mm_add_epi8(idx, _mm_set1_epi8(112))),
+	                    _mm_shuffle_epi8(high, _mm_sub_epi8(idx, _mm_set1_epi8(16))));
+}
+
+__attribute__((target("ssse3"))) void composeSsse3(const DoubleMap& inward_map,
+                                                   const DoubleMap& outward_map,
+                                                   Letter position,
+                                                   const DoubleMap& left_map,
+                                                   DoubleMap& result)
+{
+	const auto load = [](const DoubleMap& map, size_t offset) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(map.data() + offset));
+	};
+	const __m128i inward_low = load(inward_map, 0);
+	const __m128i inward_high = load(inward_map, 16);
+	const __m128i outward_low = load(outward_map, 0);
+	const __m128i outward_high = load(outward_map, 16);
+	const __m128i left_low = load(left_map, 0);
+	const __m128i left_high = load(left_map, 16);
+	const __m128i rotation = _mm_set1_epi8(static_cast<char>(position));
+
+	for(size_t half = 0; half < 2; ++half)
+	{
+		const __m128i in = _mm_load_si128(reinterpret_cast<const __m128i*>(LETTER_LANES + 16 * half));
+		const __m128i inward = lookup(inward_low, inward_high, mod26(_mm_add_epi8(in, rotation)));
+		const __m128i out = lookup(left_low, left_high, mod26(_mm_add_epi8(in, inward)));
+		const __m128i outward = lookup(outward_low, outward_high, mod26(_mm_add_epi8(out, rotation)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(result.data() + 16 * half), mod26(_mm_add_epi8(out, outward)));
+	}
+	bombe::extendMap(result);
+}
+
+__attribute__((target("avx2"))) inline __m256i loadMap(const DoubleMap& map)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(map.data()));
+}
+
+__attribute__((target("avx2"))) inline __m256i mod26(__m256i sum)
+{
+	return _mm256_min_epu8(sum, _mm256_sub_epi8(sum, _mm256_set1_epi8(NUM_LETTERS)));
+}
+
+// As the SSSE3 lookup, with the table halves broadcast to both lanes, as vpshufb does not cross lanes
+struct Avx2Table
+{
+	__m256i low;
+	__m256i high;
+};
+
+__attribute__((target("avx2"))) inline Avx2Table loadAvx2Table(const DoubleMap& map)
+{
+	const __m256i table = loadMap(map);
+	return {_mm256_permute2x128_si256(table, table, 0x00), _mm256_permute2x128_si256(table, table, 0x11)};
+}
+
+__attribute__((target("avx2"))) inline __m256i lookup(const Avx2Table& table, __m256i idx)
+{
+	return _mm256_or_si256(_mm256_shuffle_epi8(table.low, _mm256_add_epi8(idx, _mm256_set1_epi8(112))),
+	                       _mm256_shuffle_epi8(table.high, _mm256_sub_epi8(idx, _mm256_set1_epi8(16))));
+}
+
+__attribute__((target("avx2"))) void composeAvx2(const DoubleMap& inward_map,
+                                                 const DoubleMap& outward_map,
+                                                 Letter position,
+                                                 const DoubleMap& left_map,
+                                                 DoubleMap& result)
+{
+	const __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(LETTER_LANES));
+	const __m256i rotation = _mm256_set1_epi8(static_cast<char>(position));
+	const __m256i inward = lookup(loadAvx2Table(inward_map), mod26(_mm256_add_epi8(in, rotation)));
+	const __m256i out = lookup(loadAvx2Table(left_map), mod26(_mm256_add_epi8(in, inward)));
+	const __m256i outward = lookup(loadAvx2Table(outward_map), mod26(_mm256_add_epi8(out, rotation)));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(result.data()), mod26(_mm256_add_epi8(out, outward)));
+	bombe::extendMap(result);
+}
+
+// vpermb; the zero-masking form with a full mask, as GCC 12 warns about the undefined source of the plain intrinsic
+__attribute__((target("avx512vbmi,avx512vl"))) inline __m256i lookup(const DoubleMap& map, __m256i idx)
+{
+	return _mm256_maskz_permutexvar_epi8(~__mmask32{0}, idx, loadMap(map));
+}
+
+__attribute__((target("avx512vbmi,avx512vl"))) void composeAvx512Vbmi(const DoubleMap& inward_map,
+                                                                      const DoubleMap& outward_map,
+                                                                      Letter position,
+                                                                      const DoubleMap& left_map,
+                                                                      DoubleMap& result)
+{
+	const __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(LETTER_LANES));
+	const __m256i rotation = _mm256_set1_epi8(static_cast<char>(position));
+	const __m256i inward = lookup(inward_map, mod26(_mm256_add_epi8(in, rotation)));
+	const __m256i out = lookup(left_map, mod26(_mm256_add_epi8(in, inward)));
+	const __m256i outward = lookup(outward_map, mod26(_mm256_add_epi8(out, rotation)));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(result.data()), mod26(_mm256_add_epi8(out, outward)));
+	bombe::extendMap(result);
+}
+
+#endif // BOMBE_X86_KERNELS
+
+} // anonymous namespace
+
+namespace bombe {
+
+SimdLevel detectSimdLevel()
+{
+#ifdef BOMBE_X86_KERNELS
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512vl"))
+	{
+		return SimdLevel::AVX512_VBMI;
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return SimdLevel::AVX2;
+	}
+	if(__builtin_cpu_supports("ssse3"))
+	{
+		return SimdLevel::SSSE3;
+	}
+#endif
+	return SimdLevel::SCALAR;
+}
+
+RotorComposer rotorComposer(SimdLevel level)
+{
+	if(level > detectSimdLevel())
+	{
+		throw std::invalid_argument("SIMD level not supported on this CPU");
+	}
+
+	switch(level)
+	{
+#ifdef BOMBE_X86_KERNELS
+	case SimdLevel::SSSE3:
+		return &composeSsse3;
+	case SimdLevel::AVX2:
+		return &composeAvx2;
+	case SimdLevel::AVX512_VBMI:
+		return &composeAvx512Vbmi;
+#endif
+	default:
+		return &composeScalar;
+	}
+}
+
+void composeRotorMap(const DoubleMap& inward_map,
+                     const DoubleMap& outward_map,
+                     Letter position,
+                     const DoubleMap& left_map,
+                     DoubleMap& result)
+{
+	static const RotorComposer composer = rotorComposer(detectSimdLevel());
+	composer(inward_map, outward_map, position, left_map, result);
+}
+
+} // namespace bombe
@@ -0,0 +1,40 @@
+#ifndef BOMBE_ROTOR_KERNELS_H
+#define BOMBE_ROTOR_KERNELS_H
+
+#include "types.h"
+
+namespace bombe {
+
+// Instruction sets of the rotor composition kernels, from slowest to fastest
+enum class SimdLevel : uint8_t
+{
+	SCALAR,
+	SSSE3,       // pshufb on two 16-byte halves
+	AVX2,        // vpshufb on both lanes at once
+	AVX512_VBMI, // vpermb, a full 32-byte table lookup
+};
+
+// result[in] = out + outward_map[out + position] with out = left_map[in + inward_map[in + position]] (modulo 26):
+// a rotor at a position composed with everything on its left. All maps are offsets or permutations of 26 letters.
+using RotorComposer = void (*)(const DoubleMap& inward_map,
+                               const DoubleMap& outward_map,
+                               Letter position,
+                               const DoubleMap& left_map,
+                               DoubleMap& result);
+
+// Best level of this CPU and build (x86-64 with GCC or Clang; scalar elsewhere)
+SimdLevel detectSimdLevel();
+
+// Kernel of a level, which must not exceed detectSimdLevel()
+RotorComposer rotorComposer(SimdLevel level);
+
+// With the kernel of detectSimdLevel(), selected on first use
+void composeRotorMap(const DoubleMap& inward_map,
+                     const DoubleMap& outward_map,
+                     Letter position,
+                     const DoubleMap& left_map,
+                     DoubleMap& result);
+
+} // namespace bombe
+
+#endif // BOMBE_ROTOR_KERNELS_H
@@ -5,32 +5,88 @@
 namespace bombe {
 
 Scrambler::Scrambler(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
-	: reflector_{reflector_model}
-	, rotors_{rotor_models.size()}
 {
-	if((numRotors() != 3) && (numRotors() != 4))
+	reconfigure(reflector_model, rotor_models);
+}
+
+void Scrambler::reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models)
+{
+	if((rotor_models.size() != 3) && (rotor_models.size() != 4))
 	{
 		throw std::invalid_argument("Wrong number of rotors");
 	}
 
-	const DoubleMap* left_reflector = &reflector_;
-	for(size_t k = 0; k < numRotors(); ++k)
+	reflector_ = Reflector(reflector_model);
+	num_rotors_ = rotor_models.size();
+	for(size_t k = 0; k < num_rotors_; ++k)
+	{
+		rotors_[k] = Rotor(rotor_models[k]);
+	}
+
+	const bool is_thin_reflector =
+		(reflector_model == ReflectorModel::THIN_B) || (reflector_model == ReflectorModel::THIN_C);
+	const bool is_greek_rotor =
+		(rotor_models[0] == RotorModel::M_BETA) || (rotor_models[0] == RotorModel::M_GAMMA);
+	effective_reflectors_ = nullptr;
+	if((num_rotors_ == 4) && is_thin_reflector && is_greek_rotor)
 	{
-		rotors_[k] = Rotor(rotor_models[k], left_reflector);
-		left_reflector = &rotors_[k];
+		effective_reflectors_ = &effectiveReflectors(reflector_model, rotor_models[0]);
 	}
 }
 
+const Scrambler::EffectiveReflectors& Scrambler::effectiveReflectors(ReflectorModel reflector_model,
+                                                                     RotorModel greek_model)
+{
+	// [thin reflector][Greek rotor][Greek rotor position]
+	using Tables = std::array<std::array<EffectiveReflectors, 2>, 2>;
+	static const Tables tables = [] {
+		Tables result;
+		for(size_t r = 0; r < 2; ++r)
+		{
+			const Reflector reflector(r == 0 ? ReflectorModel::THIN_B : ReflectorModel::THIN_C);
+			for(size_t g = 0; g < 2; ++g)
+			{
+				Rotor greek_rotor(g == 0 ? RotorModel::M_BETA : RotorModel::M_GAMMA);
+				for(Letter position = 0; position < NUM_LETTERS; ++position)
+				{
+					greek_rotor.setPosition(position, reflector);
+					result[r][g][position] = greek_rotor;
+				}
+			}
+		}
+		return result;
+	}();
+
+	return tables[(reflector_model == ReflectorModel::THIN_B) ? 0 : 1][(greek_model == RotorModel::M_BETA) ? 0 : 1];
+}
+
+void Scrambler::setReflectorWiring(const DoubleMap& wiring)
+{
+	if(num_rotors_ != 3)
+	{
+		throw std::invalid_argument("A rewirable reflector needs three rotors");
+	}
+
+	reflector_ = Reflector(wiring);
+}
+
 void Scrambler::setRotorPosition(size_t rotor_idx, Letter position)
 {
-	assert(rotor_idx < rotors_.size());
+	assert(rotor_idx < num_rotors_);
+
+	if((rotor_idx == 0) && (effective_reflectors_ != nullptr))
+	{
+		rotors_[0].setComposedPosition(position, (*effective_reflectors_)[position]);
+		return;
+	}
 
-	rotors_[rotor_idx].setPosition(position);
+	const DoubleMap& left_map = (rotor_idx == 0) ? static_cast<const DoubleMap&>(reflector_) : rotors_[rotor_idx - 1];
+	rotors_[rotor_idx].setPosition(position, left_map);
 }
 
 void Scrambler::setRotorRing(size_t rotor_idx, Letter ring_position)
 {
-	assert(rotor_idx < rotors_.size());
+	assert(rotor_idx < num_rotors_);
 
 	rotors_[rotor_idx].setRing(ring_position);
 }
@@ -4,8 +4,6 @@
 #include "reflector.h"
 #include "rotor.h"
 
-#include <vector>
-
 namespace bombe {
 
 class Scrambler
@@ -13,13 +11,19 @@ class Scrambler
 public:
 	Scrambler(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
 
+	// Swap in other reflector/rotor models without allocation. Rotor positions and rings must be set again.
+	void reconfigure(ReflectorModel reflector_model, std::span<const RotorModel> rotor_models);
+
+	// Rewire the reflector (UKW-D, three rotors only). Rotor positions must be set again.
+	void setReflectorWiring(const DoubleMap& wiring);
+
 	void setRotorPosition(size_t rotor_idx, Letter position);
 
 	void setRotorRing(size_t rotor_idx, Letter ring_position);
 
 	const DoubleMap& map() const
 	{
-		return rotors_.back();
+		return rotors_[num_rotors_ - 1];
 	}
 
 	const Rotor& rotor(size_t rotor_idx) const
@@ -29,12 +33,19 @@ public:
 
 	size_t numRotors() const
 	{
-		return rotors_.size();
+		return num_rotors_;
 	}
 
+	// M4 only: the thin reflector and Greek rotor at one position act as a single reflector. The effective reflectors
+	// of all 26 Greek rotor positions are precomputed, so an M4 scrambler costs the rotor compositions of an M3.
+	using EffectiveReflectors = std::array<DoubleMap, NUM_LETTERS>;
+	static const EffectiveReflectors& effectiveReflectors(ReflectorModel reflector_model, RotorModel greek_model);
+
 private:
 	Reflector reflector_;
-	std::vector<Rotor> rotors_;
+	const EffectiveReflectors* effective_reflectors_{nullptr};
+	std::array<Rotor, MAX_ROTORS> rotors_;
+	size_t num_rotors_{0};
 };
 
 } // namespace bombe
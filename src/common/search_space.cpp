@@ -0,0 +1,71 @@
+#include "search_space.h"
+
+namespace bombe {
+
+uint64_t SearchSpace::size(size_t num_rotors) const
+{
+	uint64_t num_positions = 1;
+	for(size_t k = 0; k < num_rotors; ++k)
+	{
+		num_positions *= positions[k].count();
+	}
+	return num_positions;
+}
+
+std::bitset<NUM_LETTERS> parseLetterRanges(std::string_view item)
+{
+	std::bitset<NUM_LETTERS> letters;
+	if(item == "*")
+	{
+		return letters.set();
+	}
+	if(item.empty())
+	{
+		throw std::invalid_argument("Empty rotor position range");
+	}
+
+	for(size_t idx = 0; idx < item.size();)
+	{
+		const Letter first = char2Letter(item[idx]);
+		Letter last = first;
+		if((idx + 2 < item.size()) && (item[idx + 1] == '-'))
+		{
+			last = char2Letter(item[idx + 2]);
+			idx += 3;
+		}
+		else
+		{
+			idx += 1;
+		}
+		for(Letter letter = first;; letter = (letter + 1) % NUM_LETTERS)
+		{
+			letters.set(letter);
+			if(letter == last)
+			{
+				break;
+			}
+		}
+	}
+	return letters;
+}
+
+SearchSpace parseSearchSpace(std::string_view spec, size_t num_rotors)
+{
+	SearchSpace search_space;
+	for(size_t k = 0; k < num_rotors; ++k)
+	{
+		const size_t comma = spec.find(',');
+		if((comma == std::string_view::npos) != (k == num_rotors - 1))
+		{
+			throw std::invalid_argument("Search space must have one item per rotor");
+		}
+		const auto item = spec.substr(0, comma);
+		spec = (comma == std::string_view::npos) ? std::string_view() : spec.substr(comma + 1);
+
+		search_space.positions[k] = parseLetterRanges(item);
+	}
+
+	return search_space;
+}
+
+} // namespace bombe
@@ -0,0 +1,38 @@
+#ifndef BOMBE_SEARCH_SPACE_H
+#define BOMBE_SEARCH_SPACE_H
+
+#include "rotor.h"
+
+#include <bitset>
+#include <string_view>
+
+namespace bombe {
+
+// Allowed positions of each rotor, leftmost rotor first. Positions are those reported in stops (the rotor positions of
+// the first menu edge), so a known Greek rotor setting or a narrowed slow rotor range can be searched directly.
+struct SearchSpace
+{
+	std::array<std::bitset<NUM_LETTERS>, MAX_ROTORS> positions;
+
+	SearchSpace()
+	{
+		for(auto& rotor_positions : positions)
+		{
+			rotor_positions.set();
+		}
+	}
+
+	// Number of bombe positions in the search space
+	uint64_t size(size_t num_rotors) const;
+};
+
+// Letters and letter ranges such as "Q", "A-F", "X-C" (wrapping around) or "ACX-Z"; "*" for all letters
+std::bitset<NUM_LETTERS> parseLetterRanges(std::string_view item);
+
+// Parse a comma separated specification, one item per rotor: "*" for any position, or a sequence of letters and
+// letter ranges such as "Q", "A-F", "X-C" (wrapping around) or "ACX-Z". Example for M4: "B,*,*,A-F"
+SearchSpace parseSearchSpace(std::string_view spec, size_t num_rotors);
+
+} // namespace bombe
+
+#endif // BOMBE_SEARCH_SPACE_H
@@ -0,0 +1,63 @@
+#include "stepping.h"
+
+namespace bombe {
+
+SteppingSchedule::SteppingSchedule(std::array<Letter, 3> start_positions,
+                                   const std::bitset<NUM_LETTERS>& middle_turnovers,
+                                   const std::bitset<NUM_LETTERS>& fast_turnovers)
+	: start_positions_{start_positions}
+{
+	const DoubleMap& null_map = nullDoubleMap();
+
+	// Key press at which each (middle, fast) state was first seen
+	std::array<uint16_t, MAX_PERIOD> first_seen;
+	first_seen.fill(UINT16_MAX);
+
+	Letter middle = start_positions[1];
+	Letter fast = start_positions[2];
+	uint16_t slow_steps = 0;
+	for(uint16_t press = 0;; ++press)
+	{
+		const size_t state = middle * NUM_LETTERS + fast;
+		middle_positions_[press] = middle;
+		slow_steps_[press] = slow_steps;
+		if(first_seen[state] != UINT16_MAX)
+		{
+			cycle_start_ = first_seen[state];
+			cycle_length_ = press - cycle_start_;
+			break;
+		}
+		first_seen[state] = press;
+
+		// Same stepping as Enigma::stepScrambler()
+		if(middle_turnovers[middle])
+		{
+			++slow_steps;
+			middle = null_map[middle + 1];
+		}
+		else if(fast_turnovers[fast])
+		{
+			middle = null_map[middle + 1];
+		}
+		fast = null_map[fast + 1];
+	}
+}
+
+std::array<Letter, 3> SteppingSchedule::positionsAfter(size_t num_presses) const
+{
+	size_t idx = num_presses;
+	size_t num_cycles = 0;
+	if(num_presses >= cycle_start_ + cycle_length_)
+	{
+		num_cycles = (num_presses - cycle_start_) / cycle_length_;
+		idx = cycle_start_ + (num_presses - cycle_start_) % cycle_length_;
+	}
+
+	const size_t cycle_slow_steps = slow_steps_[cycle_start_ + cycle_length_] - slow_steps_[cycle_start_];
+	const size_t slow_steps = slow_steps_[idx] + (num_cycles % NUM_LETTERS) * cycle_slow_steps;
+	return {static_cast<Letter>((start_positions_[0] + slow_steps) % NUM_LETTERS),
+	        middle_positions_[idx],
+	        static_cast<Letter>((start_positions_[2] + num_presses) % NUM_LETTERS)};
+}
+
+} // namespace bombe
@@ -0,0 +1,36 @@
+#ifndef BOMBE_STEPPING_H
+#define BOMBE_STEPPING_H
+
+#include "types.h"
+
+#include <bitset>
+
+namespace bombe {
+
+// Positions of the slow/middle/fast rotors after any number of key presses, in O(1).
+// The (middle, fast) motion does not depend on the slow rotor, so it is tabulated once until it becomes periodic
+// (at most 26*26 key presses); the slow rotor advances once per double step of the middle rotor.
+class SteppingSchedule
+{
+public:
+	// Rotor core positions and turnover sets, as in Rotor::position() and Rotor::turnovers()
+	SteppingSchedule(std::array<Letter, 3> start_positions,
+	                 const std::bitset<NUM_LETTERS>& middle_turnovers,
+	                 const std::bitset<NUM_LETTERS>& fast_turnovers);
+
+	// Slow/middle/fast core positions after num_presses key presses
+	std::array<Letter, 3> positionsAfter(size_t num_presses) const;
+
+private:
+	static constexpr size_t MAX_PERIOD = NUM_LETTERS * NUM_LETTERS;
+
+	std::array<Letter, 3> start_positions_;
+	size_t cycle_start_{0};
+	size_t cycle_length_{0};
+	std::array<Letter, MAX_PERIOD + 1> middle_positions_;
+	std::array<uint16_t, MAX_PERIOD + 1> slow_steps_;
+};
+
+} // namespace bombe
+
+#endif // BOMBE_STEPPING_H
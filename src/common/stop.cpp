@@ -0,0 +1,201 @@
+#include "stop.h"
+
+#include <charconv>
+#include <algorithm>
+
+namespace {
+
+constexpr std::array<char, 8> STOP_FILE_MAGIC = {'B', 'O', 'M', 'B', 'S', 'T', 'O', 'P'};
+constexpr uint32_t STOP_FILE_VERSION = 2;
+constexpr uint32_t STOP_FILE_VERSION_WITHOUT_TURNOVER = 1; // the turnover field was reserved and always 0
+
+constexpr uint8_t THIN_ROTOR_NIBBLE = 9;
+
+uint8_t rotorNibble(bombe::RotorModel model)
+{
+	const auto value = static_cast<uint8_t>(model);
+	return (value > 100) ? (value - 101 + THIN_ROTOR_NIBBLE) : value;
+}
+
+bombe::RotorModel nibbleRotor(uint8_t nibble)
+{
+	return bombe::getRotorModel(nibble >= THIN_ROTOR_NIBBLE,
+	                            (nibble >= THIN_ROTOR_NIBBLE) ? (nibble - THIN_ROTOR_NIBBLE + 1) : nibble);
+}
+
+char* appendNumber(char* out, int value)
+{
+	return std::to_chars(out, out + 4, value).ptr;
+}
+
+char* appendPositions(char* out, const bombe::Stop& stop)
+{
+	std::array<bombe::Letter, bombe::MAX_ROTORS> positions;
+	stop.rotorPositions(positions);
+	bombe::letter2Char(std::span(positions).first(stop.num_rotors), {out, stop.num_rotors});
+	return out + stop.num_rotors;
+}
+
+} // anonymous namespace
+
+namespace bombe {
+
+uint16_t encodeWheelOrder(std::span<const RotorModel> rotor_models)
+{
+	assert(rotor_models.size() <= MAX_ROTORS);
+	uint16_t wheel_order = 0;
+	for(const auto model : rotor_models)
+	{
+		wheel_order = static_cast<uint16_t>((wheel_order << 4) | rotorNibble(model));
+	}
+	return wheel_order;
+}
+
+void decodeWheelOrder(uint16_t wheel_order, std::span<RotorModel> rotor_models)
+{
+	for(size_t k = rotor_models.size(); k-- > 0;)
+	{
+		rotor_models[k] = nibbleRotor(wheel_order & 0xF);
+		wheel_order >>= 4;
+	}
+}
+
+uint32_t encodePositions(std::span<const Letter> positions)
+{
+	uint32_t position_index = 0;
+	for(const auto position : positions)
+	{
+		position_index = position_index * NUM_LETTERS + position;
+	}
+	return position_index;
+}
+
+void decodePositions(uint32_t position_index, std::span<Letter> positions)
+{
+	for(size_t k = positions.size(); k-- > 0;)
+	{
+		positions[k] = static_cast<Letter>(position_index % NUM_LETTERS);
+		position_index /= NUM_LETTERS;
+	}
+}
+
+uint32_t numPositions(size_t num_rotors)
+{
+	uint32_t num_positions = 1;
+	for(size_t k = 0; k < num_rotors; ++k)
+	{
+		num_positions *= NUM_LETTERS;
+	}
+	return num_positions;
+}
+
+size_t formatStopText(const Stop& stop, std::span<char, MAX_STOP_TEXT_SIZE> text)
+{
+	std::array<RotorModel, MAX_ROTORS> rotor_models;
+	stop.rotorModels(rotor_models);
+
+	char* out = appendNumber(text.data(), int(stop.reflector_model));
+	for(size_t k = 0; k < stop.num_rotors; ++k)
+	{
+		*out++ = ' ';
+		out = appendNumber(out, int(rotor_models[k]));
+	}
+	out = std::fill_n(out, 4, ' ');
+	out = appendPositions(out, stop);
+	*out++ = ' ';
+	*out++ = letter2Char(stop.stecker[0]);
+	*out++ = ':';
+	*out++ = letter2Char(stop.stecker[1]);
+	if(stop.turnover != 0)
+	{
+		out = std::copy_n(" T:", 3, out);
+		*out++ = letter2Char(static_cast<Letter>(stop.turnover - 1));
+	}
+	return out - text.data();
+}
+
+size_t formatStopCsv(const Stop& stop, std::span<char, MAX_STOP_TEXT_SIZE> text)
+{
+	std::array<RotorModel, MAX_ROTORS> rotor_models;
+	stop.rotorModels(rotor_models);
+
+	char* out = appendNumber(text.data(), int(stop.reflector_model));
+	for(size_t k = 0; k < stop.num_rotors; ++k)
+	{
+		*out++ = (k == 0) ? ',' : '-';
+		out = appendNumber(out, int(rotor_models[k]));
+	}
+	*out++ = ',';
+	out = appendPositions(out, stop);
+	*out++ = ',';
+	*out++ = letter2Char(stop.stecker[0]);
+	*out++ = ':';
+	*out++ = letter2Char(stop.stecker[1]);
+	*out++ = ',';
+	if(stop.turnover != 0)
+	{
+		*out++ = letter2Char(static_cast<Letter>(stop.turnover - 1));
+	}
+	return out - text.data();
+}
+
+StopWriter::StopWriter(const std::string& filename)
+	: ofs_{filename, std::ios::binary}
+{
+	if(!ofs_.is_open())
+	{
+		throw std::invalid_argument("Cannot open the stop file " + filename);
+	}
+
+	const StopFileHeader header{STOP_FILE_MAGIC, STOP_FILE_VERSION, sizeof(Stop)};
+	ofs_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void StopWriter::write(std::span<const Stop> stops)
+{
+	ofs_.write(reinterpret_cast<const char*>(stops.data()), stops.size_bytes());
+	if(!ofs_)
+	{
+		throw std::runtime_error("Cannot write the stop file");
+	}
+}
+
+void StopWriter::flush()
+{
+	ofs_.flush();
+}
+
+StopReader::StopReader(const std::string& filename)
+	: ifs_{filename, std::ios::binary}
+{
+	if(!ifs_.is_open())
+	{
+		throw std::invalid_argument("Cannot open the stop file " + filename);
+	}
+
+	StopFileHeader header;
+	ifs_.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if(!ifs_ || (header.magic != STOP_FILE_MAGIC))
+	{
+		throw std::runtime_error("Not a stop file: " + filename);
+	}
+	const bool known_version =
+		(header.version == STOP_FILE_VERSION) || (header.version == STOP_FILE_VERSION_WITHOUT_TURNOVER);
+	if(!known_version || (header.record_size != sizeof(Stop)))
+	{
+		throw std::runtime_error("Unsupported stop file version");
+	}
+}
+
+size_t StopReader::read(std::span<Stop> stops)
+{
+	ifs_.read(reinterpret_cast<char*>(stops.data()), stops.size_bytes());
+	const auto num_bytes = static_cast<size_t>(ifs_.gcount());
+	if((num_bytes % sizeof(Stop)) != 0)
+	{
+		throw std::runtime_error("Truncated stop file");
+	}
+	return num_bytes / sizeof(Stop);
+}
+
+} // namespace bombe
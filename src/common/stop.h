@@ -0,0 +1,91 @@
+#ifndef BOMBE_STOP_H
+#define BOMBE_STOP_H
+
+#include "reflector.h"
+#include "rotor.h"
+
+#include <fstream>
+
+namespace bombe {
+
+// Wheel order packed into one nibble per rotor (left-most rotor in the most significant used nibble)
+uint16_t encodeWheelOrder(std::span<const RotorModel> rotor_models);
+
+void decodeWheelOrder(uint16_t wheel_order, std::span<RotorModel> rotor_models);
+
+// Rotor positions as a base-26 number (left-most rotor is the most significant digit)
+uint32_t encodePositions(std::span<const Letter> positions);
+
+void decodePositions(uint32_t position_index, std::span<Letter> positions);
+
+// Number of rotor positions (26^num_rotors)
+uint32_t numPositions(size_t num_rotors);
+
+struct Stop
+{
+	ReflectorModel reflector_model;
+	uint8_t num_rotors;
+	uint16_t wheel_order;
+	uint32_t position_index;
+	std::array<Letter, 2> stecker;
+	uint16_t turnover; // turnover hypothesis (see Bombe::setTurnoverHypotheses()): 0 for none, else 1 + its letter
+
+	void rotorModels(std::span<RotorModel> rotor_models) const
+	{
+		decodeWheelOrder(wheel_order, rotor_models.first(num_rotors));
+	}
+
+	void rotorPositions(std::span<Letter> positions) const
+	{
+		decodePositions(position_index, positions.first(num_rotors));
+	}
+};
+static_assert(sizeof(Stop) == 12, "Invalid Stop size");
+static_assert(std::is_trivially_copyable_v<Stop>, "Stop must be trivially copyable");
+
+// Text output, e.g. "1 2 1 3    BGX E:X", followed by " T:K" for the turnover hypothesis at K
+inline constexpr size_t MAX_STOP_TEXT_SIZE = 40;
+
+size_t formatStopText(const Stop& stop, std::span<char, MAX_STOP_TEXT_SIZE> text);
+
+size_t formatStopCsv(const Stop& stop, std::span<char, MAX_STOP_TEXT_SIZE> text);
+
+inline constexpr std::string_view STOP_CSV_HEADER = "reflector,wheel_order,positions,stecker,turnover";
+
+// Binary stop file: a StopFileHeader followed by packed Stop records (host byte order). Version 1 files, written
+// before turnover hypotheses, are read as version 2 files without any.
+struct StopFileHeader
+{
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t record_size;
+};
+
+class StopWriter
+{
+public:
+	explicit StopWriter(const std::string& filename);
+
+	void write(std::span<const Stop> stops);
+
+	void flush();
+
+private:
+	std::ofstream ofs_;
+};
+
+class StopReader
+{
+public:
+	explicit StopReader(const std::string& filename);
+
+	// Read up to stops.size() records, returns the number of records read (0 at end of file)
+	size_t read(std::span<Stop> stops);
+
+private:
+	std::ifstream ifs_;
+};
+
+} // namespace bombe
+
+#endif // BOMBE_STOP_H
@@ -0,0 +1,46 @@
+#include "thread_affinity.h"
+
+#ifdef __linux__
+#	include <sched.h>
+#endif
+
+namespace bombe {
+
+std::vector<size_t> availableCpus()
+{
+	std::vector<size_t> cpus;
+#ifdef __linux__
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+	{
+		for(size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if(CPU_ISSET(cpu, &cpu_set))
+			{
+				cpus.push_back(cpu);
+			}
+		}
+	}
+#endif
+	return cpus;
+}
+
+bool pinCurrentThread(size_t cpu)
+{
+#ifdef __linux__
+	if(cpu >= CPU_SETSIZE)
+	{
+		return false;
+	}
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+} // namespace bombe
@@ -0,0 +1,17 @@
+#ifndef BOMBE_THREAD_AFFINITY_H
+#define BOMBE_THREAD_AFFINITY_H
+
+#include <cstddef>
+#include <vector>
+
+namespace bombe {
+
+// CPUs the process is allowed to run on, in ascending order (empty if unknown)
+std::vector<size_t> availableCpus();
+
+// Pin the calling thread to a single CPU; returns false if not supported or failed
+bool pinCurrentThread(size_t cpu);
+
+} // namespace bombe
+
+#endif // BOMBE_THREAD_AFFINITY_H
@@ -1,6 +1,7 @@
 #ifndef BOMBE_TYPES_H
 #define BOMBE_TYPES_H
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -25,7 +26,7 @@ char letter2Char(Letter letter);
 
 void letter2Char(std::span<const Letter> letters, std::span<char> chars);
 
-inline void extendMap(DoubleMap& map)
+constexpr void extendMap(DoubleMap& map)
 {
 	std::copy(map.begin(), map.begin() + NUM_LETTERS, map.begin() + NUM_LETTERS);
 }
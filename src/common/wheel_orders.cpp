@@ -0,0 +1,248 @@
+#include "wheel_orders.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace bombe {
+
+namespace {
+
+std::vector<size_t> parseNumbers(std::istream& is)
+{
+	std::vector<size_t> numbers;
+	for(std::string token; is >> token;)
+	{
+		size_t size = 0;
+		numbers.push_back(std::stoul(token, &size));
+		if(size != token.size())
+		{
+			throw std::invalid_argument("Invalid number in wheel order rule: " + token);
+		}
+	}
+	return numbers;
+}
+
+// Rules give model numbers without the offset of the thin models (101 and up), which is added where thin models belong
+// (the greek rule and slot 1 of M4). Larger numbers would name a thin model elsewhere, or wrap into another model.
+constexpr size_t MAX_MODEL_NUMBER = 99;
+
+ReflectorModel checkedReflectorModel(size_t num_rotors, size_t model_number)
+{
+	if(model_number > MAX_MODEL_NUMBER)
+	{
+		throw std::invalid_argument("Invalid reflector model number: " + std::to_string(model_number));
+	}
+	const auto model = getReflectorModel(num_rotors == 4, model_number);
+	reflectorWiring(model);
+	return model;
+}
+
+RotorModel checkedRotorModel(bool is_thin, size_t model_number)
+{
+	if(model_number > MAX_MODEL_NUMBER)
+	{
+		throw std::invalid_argument("Invalid rotor model number: " + std::to_string(model_number));
+	}
+	const auto model = getRotorModel(is_thin, model_number);
+	rotorWiring(model);
+	return model;
+}
+
+std::vector<RotorModel> rotorModels(std::span<const size_t> numbers, bool is_thin)
+{
+	std::vector<RotorModel> models;
+	for(const auto number : numbers)
+	{
+		models.push_back(checkedRotorModel(is_thin, number));
+	}
+	return models;
+}
+
+bool contains(std::span<const RotorModel> models, RotorModel model)
+{
+	return std::find(models.begin(), models.end(), model) != models.end();
+}
+
+} // anonymous namespace
+
+WheelOrderRules::WheelOrderRules(size_t num_rotors)
+	: num_rotors{num_rotors}
+{
+	if(num_rotors == 3)
+	{
+		reflectors = {ReflectorModel::REGULAR_B, ReflectorModel::REGULAR_C};
+		rotors = {RotorModel::M_I, RotorModel::M_II, RotorModel::M_III, RotorModel::M_IV, RotorModel::M_V};
+	}
+	else if(num_rotors == 4)
+	{
+		reflectors = {ReflectorModel::THIN_B, ReflectorModel::THIN_C};
+		greek_rotors = {RotorModel::M_BETA, RotorModel::M_GAMMA};
+		rotors = {RotorModel::M_I,
+		          RotorModel::M_II,
+		          RotorModel::M_III,
+		          RotorModel::M_IV,
+		          RotorModel::M_V,
+		          RotorModel::M_VI,
+		          RotorModel::M_VII,
+		          RotorModel::M_VIII};
+	}
+	else
+	{
+		throw std::invalid_argument("Invalid number of rotors");
+	}
+}
+
+void WheelOrderRules::parseRule(std::string_view rule)
+{
+	std::istringstream iss(std::string(rule.substr(0, rule.find('#'))));
+	std::string name;
+	if(!(iss >> name))
+	{
+		return;
+	}
+	const auto numbers = parseNumbers(iss);
+	if(numbers.empty())
+	{
+		throw std::invalid_argument("Wheel order rule without models: " + std::string(rule));
+	}
+
+	if(name == "reflectors")
+	{
+		reflectors.clear();
+		for(const auto number : numbers)
+		{
+			reflectors.push_back(checkedReflectorModel(num_rotors, number));
+		}
+	}
+	else if(name == "greek")
+	{
+		if(num_rotors != 4)
+		{
+			throw std::invalid_argument("Greek rotors need a 4-rotor menu");
+		}
+		greek_rotors = rotorModels(numbers, true);
+	}
+	else if(name == "rotors")
+	{
+		rotors = rotorModels(numbers, false);
+	}
+	else if(name == "slot")
+	{
+		const size_t slot = numbers[0];
+		if((slot < 1) || (slot > num_rotors) || (numbers.size() < 2))
+		{
+			throw std::invalid_argument("Invalid slot rule: " + std::string(rule));
+		}
+		slots[slot - 1] = rotorModels(std::span(numbers).subspan(1), (num_rotors == 4) && (slot == 1));
+	}
+	else if(name == "require")
+	{
+		required.push_back(rotorModels(numbers, false));
+	}
+	else if(name == "exclude")
+	{
+		if(numbers.size() != num_rotors + 1)
+		{
+			throw std::invalid_argument("Invalid exclude rule: " + std::string(rule));
+		}
+		auto& wheel_order = excluded.emplace_back();
+		wheel_order.first = checkedReflectorModel(num_rotors, numbers[0]);
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			wheel_order.second.push_back(checkedRotorModel((num_rotors == 4) && (k == 0), numbers[k + 1]));
+		}
+	}
+	else
+	{
+		throw std::invalid_argument("Unknown wheel order rule: " + name);
+	}
+}
+
+void WheelOrderRules::parseRules(std::string_view rules)
+{
+	while(!rules.empty())
+	{
+		const size_t end = std::min(rules.find_first_of(";\n"), rules.size());
+		parseRule(rules.substr(0, end));
+		rules = rules.substr(std::min(end + 1, rules.size()));
+	}
+}
+
+void WheelOrderRules::loadRules(const std::string& filename)
+{
+	std::ifstream ifs(filename);
+	if(!ifs.is_open())
+	{
+		throw std::invalid_argument("Cannot open the wheel order rules file " + filename);
+	}
+	for(std::string line; std::getline(ifs, line);)
+	{
+		parseRule(line);
+	}
+}
+
+bool WheelOrderRules::admits(const WheelOrder& wheel_order) const
+{
+	const auto& models = wheel_order.second;
+	for(size_t k = 0; k < models.size(); ++k)
+	{
+		if(!slots[k].empty() && !contains(slots[k], models[k]))
+		{
+			return false;
+		}
+	}
+	for(const auto& one_of : required)
+	{
+		if(std::none_of(models.begin(), models.end(), [&](RotorModel model) { return contains(one_of, model); }))
+		{
+			return false;
+		}
+	}
+	return std::find(excluded.begin(), excluded.end(), wheel_order) == excluded.end();
+}
+
+std::vector<WheelOrder> enumerateWheelOrders(const WheelOrderRules& rules)
+{
+	constexpr size_t NUM_REGULAR_ROTORS = 3;
+	auto rotors = rules.rotors;
+	std::sort(rotors.begin(), rotors.end());
+	rotors.erase(std::unique(rotors.begin(), rotors.end()), rotors.end());
+	if(rotors.size() < NUM_REGULAR_ROTORS)
+	{
+		throw std::invalid_argument("Rotor pool must have at least 3 rotors");
+	}
+
+	std::vector<WheelOrder> wheel_orders;
+	// Lexicographic 3-permutations of the pool, after the given left-most models
+	const auto add_wheel_orders = [&](ReflectorModel reflector, std::span<const RotorModel> left_models) {
+		do
+		{
+			WheelOrder wheel_order{reflector, {left_models.begin(), left_models.end()}};
+			wheel_order.second.insert(wheel_order.second.end(), rotors.begin(), rotors.begin() + NUM_REGULAR_ROTORS);
+			if(rules.admits(wheel_order))
+			{
+				wheel_orders.push_back(std::move(wheel_order));
+			}
+			std::reverse(rotors.begin() + NUM_REGULAR_ROTORS, rotors.end());
+		} while(std::next_permutation(rotors.begin(), rotors.end()));
+	};
+
+	for(const auto reflector : rules.reflectors)
+	{
+		if(rules.num_rotors == NUM_REGULAR_ROTORS)
+		{
+			add_wheel_orders(reflector, {});
+		}
+		else
+		{
+			for(const auto greek_rotor : rules.greek_rotors)
+			{
+				add_wheel_orders(reflector, std::span(&greek_rotor, 1));
+			}
+		}
+	}
+	return wheel_orders;
+}
+
+} // namespace bombe
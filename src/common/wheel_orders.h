@@ -0,0 +1,50 @@
+#ifndef BOMBE_WHEEL_ORDERS_H
+#define BOMBE_WHEEL_ORDERS_H
+
+#include "reflector.h"
+#include "rotor.h"
+
+#include <string_view>
+#include <vector>
+
+namespace bombe {
+
+using WheelOrder = std::pair<ReflectorModel, std::vector<RotorModel>>;
+
+// Wheel pools and pruning rules of an all-wheels sweep
+struct WheelOrderRules
+{
+	size_t num_rotors;
+	std::vector<ReflectorModel> reflectors;
+	std::vector<RotorModel> greek_rotors; // M4 only, left-most slot
+	std::vector<RotorModel> rotors;       // pool of the three right-most slots
+	std::array<std::vector<RotorModel>, MAX_ROTORS> slots; // allowed models per slot (empty: no restriction)
+	std::vector<std::vector<RotorModel>> required;         // each wheel order includes one rotor of every list
+	std::vector<WheelOrder> excluded;
+
+	// Historical pools: reflectors B/C with rotors I-V for M3; thin B/C, beta/gamma and rotors I-VIII for M4
+	explicit WheelOrderRules(size_t num_rotors);
+
+	// Apply one rule, with models numbered as on the command line. '#' starts a comment.
+	//   reflectors <UKW>...     reflector pool
+	//   greek <G>...            Greek rotor pool (M4)
+	//   rotors <R>...           rotor pool
+	//   slot <idx> <R>...       models allowed in a slot (1 = left-most)
+	//   require <R>...          at least one of these rotors (e.g. "require 6 7 8" for the Kriegsmarine)
+	//   exclude <UKW> <R1>...   one wheel order, such as one already used this month
+	void parseRule(std::string_view rule);
+
+	// Rules separated by ';' or new lines
+	void parseRules(std::string_view rules);
+
+	void loadRules(const std::string& filename);
+
+	bool admits(const WheelOrder& wheel_order) const;
+};
+
+// Admissible wheel orders, by reflector, then Greek rotor, then rotors in lexicographic order
+std::vector<WheelOrder> enumerateWheelOrders(const WheelOrderRules& rules);
+
+} // namespace bombe
+
+#endif // BOMBE_WHEEL_ORDERS_H
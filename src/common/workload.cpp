@@ -0,0 +1,300 @@
+#include "workload.h"
+#include "enigma.h"
+#include "ring_recovery.h"
+#include "wheel_orders.h"
+
+#include <bitset>
+#include <cctype>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+namespace bombe {
+
+namespace {
+
+constexpr size_t MAX_ATTEMPTS = 10000;
+constexpr size_t NUM_STECKER_PAIRS = 10;
+constexpr size_t MESSAGE_MARGIN = 50; // message letters besides the crib
+
+// Fisher-Yates with the generator's raw output, so workloads do not depend on the standard library
+template<typename Container>
+void shuffle(Container& items, std::mt19937_64& rng)
+{
+	for(size_t k = items.size(); k > 1; --k)
+	{
+		std::swap(items[k - 1], items[rng() % k]);
+	}
+}
+
+std::string randomLetters(size_t size, std::mt19937_64& rng)
+{
+	std::string letters(size, ' ');
+	for(auto& ch : letters)
+	{
+		ch = letter2Char(static_cast<Letter>(rng() % NUM_LETTERS));
+	}
+	return letters;
+}
+
+} // anonymous namespace
+
+WorkloadGenerator::WorkloadGenerator(uint64_t seed, std::string corpus)
+	: rng_{seed}
+{
+	for(const char ch : corpus)
+	{
+		if(std::isalpha(static_cast<unsigned char>(ch)))
+		{
+			corpus_.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(ch))));
+		}
+	}
+	if(!corpus.empty() && corpus_.empty())
+	{
+		throw std::invalid_argument("Workload corpus has no letters");
+	}
+}
+
+Workload WorkloadGenerator::generate(const WorkloadSpec& spec)
+{
+	if(spec.crib_length > NUM_LETTERS)
+	{
+		throw std::invalid_argument("Workload crib must not exceed 26 letters");
+	}
+	if((spec.menu_length == 0) || (spec.menu_length > spec.crib_length) || (spec.num_loops >= spec.menu_length))
+	{
+		throw std::invalid_argument("Invalid workload menu length or loop count");
+	}
+
+	const auto wheel_orders = enumerateWheelOrders(WheelOrderRules(spec.num_rotors));
+	const size_t num_rotors = spec.num_rotors;
+	const size_t slow_idx = num_rotors - 3;
+	for(size_t attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+	{
+		Workload workload;
+		std::tie(workload.reflector_model, workload.rotor_models) = wheel_orders[randomIndex(wheel_orders.size())];
+		workload.ringstellung = randomLetters(num_rotors, rng_);
+		workload.grundstellung = randomLetters(num_rotors, rng_);
+
+		std::array<Letter, NUM_LETTERS> letters;
+		std::iota(letters.begin(), letters.end(), Letter(0));
+		shuffle(letters, rng_);
+		for(size_t k = 0; k < NUM_STECKER_PAIRS; ++k)
+		{
+			workload.steckers += std::string(k > 0 ? ":" : "") + letter2Char(letters[2 * k]) +
+			                     letter2Char(letters[2 * k + 1]);
+		}
+
+		workload.plaintext = randomPlaintext(spec.crib_length + MESSAGE_MARGIN);
+		Enigma enigma(workload.reflector_model, workload.rotor_models);
+		if(!spec.reflector_wiring.empty())
+		{
+			enigma.configureReflectorWiring(spec.reflector_wiring);
+			workload.reflector_model = ReflectorModel::REWIRABLE_D;
+		}
+		enigma.configureSteckers(workload.steckers);
+		enigma.configureRotors(workload.ringstellung, workload.grundstellung);
+		workload.ciphertext.resize(workload.plaintext.size());
+		enigma.process(workload.plaintext, workload.ciphertext);
+
+		// Core positions of every message letter
+		std::array<Letter, MAX_ROTORS> start_positions;
+		std::array<Rotor, 3> rotors;
+		for(size_t k = 0; k < num_rotors; ++k)
+		{
+			const Letter ring = char2Letter(workload.ringstellung[k]);
+			start_positions[k] =
+				static_cast<Letter>((char2Letter(workload.grundstellung[k]) + NUM_LETTERS - ring) % NUM_LETTERS);
+			if(k >= slow_idx)
+			{
+				rotors[k - slow_idx] = Rotor(workload.rotor_models[k]);
+				rotors[k - slow_idx].setRing(ring);
+			}
+		}
+		const SteppingSchedule schedule({start_positions[slow_idx], start_positions[slow_idx + 1],
+		                                 start_positions[slow_idx + 2]},
+		                                rotors[1].turnovers(),
+		                                rotors[2].turnovers());
+
+		// Crib offsets without middle (or slow) rotor motion
+		std::vector<size_t> crib_offsets;
+		for(size_t offset = 0; offset + spec.crib_length <= workload.plaintext.size(); ++offset)
+		{
+			const auto first = schedule.positionsAfter(offset + 1);
+			const auto last = schedule.positionsAfter(offset + spec.crib_length);
+			if((first[0] == last[0]) && (first[1] == last[1]))
+			{
+				crib_offsets.push_back(offset);
+			}
+		}
+		if(crib_offsets.empty())
+		{
+			continue;
+		}
+		workload.crib_offset = crib_offsets[randomIndex(crib_offsets.size())];
+
+		auto menu = buildMenu(spec,
+		                      std::string_view(workload.plaintext).substr(workload.crib_offset, spec.crib_length),
+		                      std::string_view(workload.ciphertext).substr(workload.crib_offset, spec.crib_length));
+		if(!menu)
+		{
+			continue;
+		}
+
+		// The register voltage goes on the true stecker partner of the register letter
+		const SingleMap stecker_map = parseSteckers(workload.steckers);
+		auto& register_letters = menu->registers.front();
+		register_letters.second = stecker_map[register_letters.first];
+		workload.menu = std::move(*menu);
+
+		// The bombe reports the core positions of the first menu edge
+		const size_t first_edge_offset = workload.menu.edges[0].rotor_positions.back();
+		const auto edge_positions = schedule.positionsAfter(workload.crib_offset + first_edge_offset + 1);
+		std::copy(edge_positions.begin(), edge_positions.end(), start_positions.begin() + slow_idx);
+
+		Stop& stop = workload.expected_stop;
+		stop.reflector_model = workload.reflector_model;
+		stop.num_rotors = static_cast<uint8_t>(num_rotors);
+		stop.wheel_order = encodeWheelOrder(workload.rotor_models);
+		stop.position_index = encodePositions(std::span(start_positions).first(num_rotors));
+		stop.stecker = {register_letters.first, register_letters.second};
+		stop.turnover = 0;
+		return workload;
+	}
+
+	throw std::invalid_argument("Cannot generate a workload of this menu length and loop count");
+}
+
+std::string WorkloadGenerator::randomPlaintext(size_t size)
+{
+	std::string plaintext(size, ' ');
+	if(!corpus_.empty())
+	{
+		const size_t start = randomIndex(corpus_.size());
+		for(size_t k = 0; k < size; ++k)
+		{
+			plaintext[k] = corpus_[(start + k) % corpus_.size()];
+		}
+		return plaintext;
+	}
+
+	std::array<double, NUM_LETTERS> cumulative;
+	double total = 0;
+	for(Letter k = 0; k < NUM_LETTERS; ++k)
+	{
+		total += std::exp(germanLogProbabilities()[k]);
+		cumulative[k] = total;
+	}
+	for(auto& ch : plaintext)
+	{
+		const double u = static_cast<double>(rng_() >> 11) / (uint64_t(1) << 53) * total;
+		const auto it = std::upper_bound(cumulative.begin(), cumulative.end(), u);
+		ch = letter2Char(static_cast<Letter>(std::min<size_t>(it - cumulative.begin(), NUM_LETTERS - 1)));
+	}
+	return plaintext;
+}
+
+std::optional<Bombe::Menu> WorkloadGenerator::buildMenu(const WorkloadSpec& spec,
+                                                        std::string_view crib_plaintext,
+                                                        std::string_view crib_ciphertext)
+{
+	std::vector<size_t> order(crib_plaintext.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+	shuffle(order, rng_);
+
+	// Grow one connected component, closing loops while more are wanted
+	std::vector<size_t> edges{order[0]};
+	std::bitset<NUM_LETTERS> menu_letters;
+	const auto edge_letters = [&](size_t crib_idx) {
+		return std::pair{char2Letter(crib_plaintext[crib_idx]), char2Letter(crib_ciphertext[crib_idx])};
+	};
+	menu_letters.set(edge_letters(order[0]).first).set(edge_letters(order[0]).second);
+	size_t num_loops = 0;
+	while(edges.size() < spec.menu_length)
+	{
+		std::optional<size_t> loop_edge;
+		std::optional<size_t> tree_edge;
+		for(const size_t crib_idx : order)
+		{
+			if(std::find(edges.begin(), edges.end(), crib_idx) != edges.end())
+			{
+				continue;
+			}
+			const auto [l1, l2] = edge_letters(crib_idx);
+			const size_t num_in_menu = menu_letters.test(l1) + menu_letters.test(l2);
+			if((num_in_menu == 2) && !loop_edge)
+			{
+				loop_edge = crib_idx;
+			}
+			else if((num_in_menu == 1) && !tree_edge)
+			{
+				tree_edge = crib_idx;
+			}
+		}
+
+		const size_t missing_loops = spec.num_loops - num_loops;
+		const size_t missing_edges = spec.menu_length - edges.size();
+		const bool close_loop = (missing_loops > 0) && (loop_edge || (missing_loops >= missing_edges));
+		const auto next_edge = close_loop ? loop_edge : tree_edge;
+		if(!next_edge)
+		{
+			return std::nullopt;
+		}
+		edges.push_back(*next_edge);
+		num_loops += close_loop ? 1 : 0;
+		const auto [l1, l2] = edge_letters(*next_edge);
+		menu_letters.set(l1).set(l2);
+	}
+	std::sort(edges.begin(), edges.end());
+
+	Bombe::Menu menu;
+	std::array<size_t, NUM_LETTERS> degrees{};
+	for(const size_t crib_idx : edges)
+	{
+		auto& edge = menu.edges.emplace_back();
+		edge.rotor_positions.assign(spec.num_rotors, 0);
+		edge.rotor_positions.back() = static_cast<Letter>(crib_idx);
+		edge.nodes = edge_letters(crib_idx);
+		++degrees[edge.nodes.first];
+		++degrees[edge.nodes.second];
+	}
+
+	// Register on the most connected letter; the caller sets the voltage wire
+	const auto register_letter =
+		static_cast<Letter>(std::max_element(degrees.begin(), degrees.end()) - degrees.begin());
+	menu.registers.emplace_back(register_letter, register_letter);
+	return menu;
+}
+
+std::vector<std::string> formatMenu(const Bombe::Menu& menu)
+{
+	std::vector<std::string> lines;
+	for(const auto& edge : menu.edges)
+	{
+		std::string line(edge.rotor_positions.size() + 2, ' ');
+		letter2Char(edge.rotor_positions, std::span(line).first(edge.rotor_positions.size()));
+		line[line.size() - 2] = letter2Char(edge.nodes.first);
+		line[line.size() - 1] = letter2Char(edge.nodes.second);
+		lines.push_back(std::move(line));
+	}
+
+	// "=R=V=" with padding to the line size, then the terminator line
+	const size_t line_size = menu.numRotors() + 2;
+	std::string register_line(line_size, '=');
+	register_line[1] = letter2Char(menu.registers[0].first);
+	register_line[3] = letter2Char(menu.registers[0].second);
+	lines.push_back(register_line);
+	lines.emplace_back(line_size, '+');
+	return lines;
+}
+
+bool containsStop(std::span<const Stop> stops, const Stop& stop)
+{
+	return std::any_of(stops.begin(), stops.end(), [&](const Stop& other) {
+		return (other.reflector_model == stop.reflector_model) && (other.num_rotors == stop.num_rotors) &&
+		       (other.wheel_order == stop.wheel_order) && (other.position_index == stop.position_index) &&
+		       (other.stecker == stop.stecker);
+	});
+}
+
+} // namespace bombe
@@ -0,0 +1,73 @@
+#ifndef BOMBE_WORKLOAD_H
+#define BOMBE_WORKLOAD_H
+
+#include "bombe.h"
+
+#include <random>
+
+namespace bombe {
+
+// Shape of a generated menu
+struct WorkloadSpec
+{
+	size_t num_rotors{3};
+	size_t menu_length{12};       // edges
+	size_t num_loops{2};          // closures (the menu is one connected component)
+	size_t crib_length{20};       // crib letters the edges are chosen from (at most 26)
+	std::string reflector_wiring; // UKW-D pairs replacing the reflector (three rotors only); empty for none
+};
+
+// A random message key, a message enciphered with it, and a bombe menu built from a crib of the message
+struct Workload
+{
+	ReflectorModel reflector_model;
+	std::vector<RotorModel> rotor_models;
+	std::string ringstellung;
+	std::string grundstellung;
+	std::string steckers;
+	std::string plaintext;
+	std::string ciphertext;
+	size_t crib_offset;
+
+	Bombe::Menu menu;
+	Stop expected_stop; // stop of the true key, for the wheel order above
+};
+
+// Reproducible workloads for a given seed. Plaintext is drawn from the corpus at random offsets, or (without corpus)
+// letter by letter with German letter frequencies. Cribs are placed where the middle rotor does not step, as the bombe
+// assumes. The register voltage is put on the true stecker partner of the register letter, so the true key always
+// stops with exactly one wire on.
+class WorkloadGenerator
+{
+public:
+	explicit WorkloadGenerator(uint64_t seed, std::string corpus = {});
+
+	Workload generate(const WorkloadSpec& spec);
+
+private:
+	size_t randomIndex(size_t size)
+	{
+		return static_cast<size_t>(rng_() % size);
+	}
+
+	std::string randomPlaintext(size_t size);
+
+	// Menu of the given shape out of the crib, if the crib allows
+	std::optional<Bombe::Menu> buildMenu(const WorkloadSpec& spec,
+	                                     std::string_view crib_plaintext,
+	                                     std::string_view crib_ciphertext);
+
+private:
+	std::mt19937_64 rng_;
+	std::string corpus_;
+};
+
+// Menu file lines, as read by Bombe::loadMenu()
+std::vector<std::string> formatMenu(const Bombe::Menu& menu);
+
+// Whether the stops include this one (same wheel order, positions and stecker pair)
+bool containsStop(std::span<const Stop> stops, const Stop& stop);
+
+} // namespace bombe
+
+#endif // BOMBE_WORKLOAD_H
@@ -1,11 +1,16 @@
 #include "cli_tools.h"
 #include "enigma.h"
+#include "message_stream.h"
+
+#include <cstdio>
 
 namespace {
 
 std::string usageSyntax()
 {
-	return "Usage: enigma_app <numrotors> <UKW> <R1> <R2> <R3> [R4] [steckers] <ring> <grun>";
+	return "Usage: enigma_app <numrotors> <UKW> <R1> <R2> <R3> [R4] [steckers] <ring> <grun>\n"
+	       "A line \"@<UKW> <R1> <R2> <R3> [R4] [steckers] <ring> <grun>\" or \"@[steckers] <ring> <grun>\" "
+	       "sets the key of the next message";
 }
 
 size_t parseNumRotors(std::span<const char* const>& args)
@@ -19,6 +24,60 @@ size_t parseNumRotors(std::span<const char* const>& args)
 	return num_rotors;
 }
 
+// Apply "[steckers] <ring> <grun>"
+void parseMessageKey(std::span<const char* const> args, bombe::Enigma& enigma)
+{
+	if((args.size() < 2) || (args.size() > 3))
+	{
+		throw std::invalid_argument("Cannot parse ringstellung/grundstellung\n");
+	}
+
+	enigma.configureSteckers((args.size() == 3) ? args[0] : "");
+	args = args.subspan(args.size() - 2);
+	enigma.configureRotors(args[0], args[1]);
+}
+
+// Parse "<UKW> <R1> <R2> <R3> [R4] [steckers] <ring> <grun>"
+bombe::Enigma parseKey(std::span<const char* const> args, size_t num_rotors)
+{
+	const auto reflector_model = bombe::cli::parseReflectorModel(args, num_rotors);
+	const auto rotor_models = bombe::cli::parseRotorModels(args, num_rotors);
+
+	bombe::Enigma enigma(reflector_model, rotor_models);
+	parseMessageKey(args, enigma);
+	return enigma;
+}
+
+// Key line of a new message: either a full key "<UKW> <R1> ... [steckers] <ring> <grun>",
+// or "[steckers] <ring> <grun>" keeping the wheel order
+void parseKeyLine(std::string_view line, size_t num_rotors, bombe::Enigma& enigma)
+{
+	std::vector<std::string> tokens;
+	for(size_t start = 0; start < line.size();)
+	{
+		const size_t end = std::min(line.find_first_of(" \t\r", start), line.size());
+		if(end > start)
+		{
+			tokens.emplace_back(line.substr(start, end - start));
+		}
+		start = end + 1;
+	}
+	std::vector<const char*> args;
+	for(const auto& token : tokens)
+	{
+		args.push_back(token.c_str());
+	}
+
+	if(args.size() > 3)
+	{
+		enigma = parseKey(args, num_rotors);
+	}
+	else
+	{
+		parseMessageKey(args, enigma);
+	}
+}
+
 } // anonymous namespace
 
 int main(int argc, char** argv)
@@ -27,48 +86,28 @@ int main(int argc, char** argv)
 	{
 		std::span<const char* const> args(argv + 1, argc - 1);
 		const auto num_rotors = parseNumRotors(args);
-		const auto reflector_model = bombe::cli::parseReflectorModel(args, num_rotors);
-		const auto rotor_models = bombe::cli::parseRotorModels(args, num_rotors);
+		auto enigma = parseKey(args, num_rotors);
 
-		bombe::Enigma enigma(reflector_model, rotor_models);
-
-		if(args.size() >= 3)
-		{
-			enigma.configureSteckers(args[0]);
-			args = args.subspan(1);
-		}
-
-		if(args.size() < 2)
+		// Stream stdin through fixed-size buffers; a line starting with '@' carries the key of the next message
+		bombe::MessageStream stream(
+			enigma,
+			[num_rotors](std::string_view key_line, bombe::Enigma& message_enigma) {
+				parseKeyLine(key_line, num_rotors, message_enigma);
+			},
+			[](std::string_view text) { std::fwrite(text.data(), 1, text.size(), stdout); });
+		std::vector<char> input(1 << 16);
+		for(size_t size; (size = std::fread(input.data(), 1, input.size(), stdin)) > 0;)
 		{
-			throw std::invalid_argument("Cannot parse ringstellung/grundstellung\n");
-		}
-		enigma.configureRotors(args[0], args[1]);
-
-		std::string output;
-		std::string input;
-		while(std::getline(std::cin, input))
-		{
-			// Remove non-alphabet characters
-			size_t num = 0;
-			for(const char ch : input)
-			{
-				if(ch != ' ')
-				{
-					input[num++] = ch;
-				}
-			}
-			input.resize(num);
-
-			const size_t cur_size = output.size();
-			output.resize(cur_size + input.size());
-			enigma.process(input, {output.data() + cur_size, input.size()});
+			stream.feed({input.data(), size});
 		}
+		stream.finish();
 
-		std::cout << output;
+		std::fflush(stdout);
 		return 0;
 	}
 	catch(const std::exception& e)
 	{
+		std::fflush(stdout);
 		std::cerr << "EXCEPTION: " << e.what() << '\n';
 		std::cout << usageSyntax() << "\n";
 		return -1;
@@ -0,0 +1,100 @@
+#include "cli_tools.h"
+#include "menu_analysis.h"
+
+#include <iomanip>
+#include <thread>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: menu_analyzer <menufile> [<UKW> <R1> <R2> <R3> [R4]] [--samples=<n>] [--threads=<n>] "
+	       "[--wheel-orders=<n>] [--seed=<n>]";
+}
+
+std::string formatDuration(double seconds)
+{
+	const auto total = static_cast<uint64_t>(seconds + 0.5);
+	std::ostringstream oss;
+	if(total < 60)
+	{
+		oss << std::setprecision(3) << seconds << " sec";
+	}
+	else
+	{
+		oss << total / 3600 << ':' << std::setfill('0') << std::setw(2) << (total / 60) % 60 << ':' << std::setw(2)
+			<< total % 60;
+	}
+	return oss.str();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		const auto menu = bombe::cli::parseMenu(args);
+		const auto num_rotors = menu.numRotors();
+
+		// The wheel order barely affects the stop rate; by default test UKW B with rotors I, II, III (M4: beta)
+		bombe::ReflectorModel reflector_model = bombe::getReflectorModel(num_rotors == 4, 1);
+		std::vector<bombe::RotorModel> rotor_models;
+		if(!args.empty() && !std::string_view(args[0]).starts_with("--"))
+		{
+			reflector_model = bombe::cli::parseReflectorModel(args, num_rotors);
+			rotor_models = bombe::cli::parseRotorModels(args, num_rotors);
+		}
+		else
+		{
+			for(size_t k = 0; k < num_rotors; ++k)
+			{
+				const bool is_thin = (num_rotors == 4) && (k == 0);
+				rotor_models.push_back(bombe::getRotorModel(is_thin, is_thin ? 1 : (k + ((num_rotors == 4) ? 0 : 1))));
+			}
+		}
+		const auto options = bombe::cli::parseOptions(args);
+
+		const size_t num_samples = bombe::cli::optionValue(options, "samples", 20000);
+		const size_t num_threads =
+			bombe::cli::optionValue(options, "threads", std::max<size_t>(std::thread::hardware_concurrency(), 1));
+		// Same wheel orders as turing_bombe_all_wheels: 2 reflectors x 60 orders, or 2 x 2 x 336 for M4
+		const size_t num_wheel_orders =
+			bombe::cli::optionValue(options, "wheel-orders", (num_rotors == 4) ? 1344 : 120);
+		const uint64_t seed = bombe::cli::optionValue(options, "seed", 1);
+
+		const auto statistics = bombe::analyzeMenu(menu);
+		const uint64_t num_positions = bombe::numPositions(num_rotors);
+		std::cout << "Menu: " << statistics.num_letters << " letters, " << statistics.num_edges << " edges, "
+				  << statistics.num_components << " components, " << statistics.num_closures << " closures\n";
+		std::cout << "Register component: " << statistics.register_letters << " letters, "
+				  << statistics.register_edges << " edges, " << statistics.register_closures << " closures\n";
+		std::cout << "Positions per wheel order: " << num_positions << '\n';
+
+		const double analytic_stops = bombe::estimateFalseStops(statistics);
+		std::cout << "Analytic estimate: " << analytic_stops << " stops per wheel order\n";
+
+		const auto sample =
+			bombe::sampleStopRate(menu, reflector_model, rotor_models, num_samples, num_threads, seed);
+		const double sampled_stops = sample.stopsPerWheelOrder(num_rotors);
+		std::cout << "Monte Carlo: " << sample.num_stops << " stops in " << sample.num_positions << " positions, "
+				  << sampled_stops << " stops per wheel order (95% upper bound "
+				  << sample.stopsPerWheelOrderUpperBound(num_rotors) << ")\n";
+
+		const double wheel_order_seconds = sample.seconds_per_position * num_positions;
+		std::cout << "Cost: " << sample.seconds_per_position * 1e6 << " us per position, "
+				  << formatDuration(wheel_order_seconds) << " per wheel order\n";
+		std::cout << "All " << num_wheel_orders << " wheel orders on " << num_threads
+				  << " threads: " << sampled_stops * num_wheel_orders << " stops, "
+				  << formatDuration(wheel_order_seconds * num_wheel_orders / num_threads) << '\n';
+
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
@@ -0,0 +1,86 @@
+#include "cli_tools.h"
+#include "ring_recovery.h"
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: ring_finder <numrotors> <UKW> <R1> <R2> <R3> [R4] <positions> [--steckers=<steckers>] "
+	       "[--offset=<n>] [--results=<n>] [--threads=<n>] < ciphertext";
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		if(args.empty())
+		{
+			throw std::invalid_argument("Cannot parse numrotors\n");
+		}
+		const size_t num_rotors = std::stoi(args[0]);
+		args = args.subspan(1);
+		const auto reflector_model = bombe::cli::parseReflectorModel(args, num_rotors);
+		const auto rotor_models = bombe::cli::parseRotorModels(args, num_rotors);
+		if(args.empty() || (std::string_view(args[0]).size() != num_rotors))
+		{
+			throw std::invalid_argument("Cannot parse rotor positions\n");
+		}
+		std::array<bombe::Letter, bombe::MAX_ROTORS> positions;
+		bombe::char2Letter(std::string_view(args[0]), std::span(positions).first(num_rotors));
+		args = args.subspan(1);
+		const auto options = bombe::cli::parseOptions(args);
+
+		bombe::Stop stop{};
+		stop.reflector_model = reflector_model;
+		stop.num_rotors = static_cast<uint8_t>(num_rotors);
+		stop.wheel_order = bombe::encodeWheelOrder(rotor_models);
+		stop.position_index = bombe::encodePositions(std::span(positions).first(num_rotors));
+
+		const auto steckers_it = options.find("steckers");
+		const std::string steckers = (steckers_it != options.end()) ? steckers_it->second : "";
+		const size_t position_offset = bombe::cli::optionValue(options, "offset", 0);
+		const size_t num_results = bombe::cli::optionValue(options, "results", 10);
+		const size_t num_threads =
+			bombe::cli::optionValue(options, "threads", std::max<size_t>(std::thread::hardware_concurrency(), 1));
+
+		std::string ciphertext;
+		for(char ch; std::cin.get(ch);)
+		{
+			if(std::isalpha(static_cast<unsigned char>(ch)))
+			{
+				ciphertext.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(ch))));
+			}
+		}
+		if(ciphertext.size() <= position_offset)
+		{
+			throw std::invalid_argument("Ciphertext is shorter than the stop offset\n");
+		}
+
+		const auto tic = std::chrono::steady_clock::now();
+		const auto candidates =
+			bombe::recoverRingSettings(stop, position_offset, steckers, ciphertext, num_results, num_threads);
+		const auto toc = std::chrono::steady_clock::now();
+
+		for(const auto& candidate : candidates)
+		{
+			std::cout << candidate.ringstellung << ' ' << candidate.grundstellung << ' ' << std::fixed
+					  << std::setprecision(3) << candidate.score << ' ' << candidate.plaintext << '\n';
+		}
+		std::cout << "Ring recovery takes " << std::chrono::duration<double>(toc - tic).count() << " sec\n";
+
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
@@ -0,0 +1,53 @@
+#include "cli_tools.h"
+#include "stop.h"
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: stop_reader <stopfile> [--csv]";
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		if(args.empty())
+		{
+			throw std::invalid_argument("Cannot parse stop file name");
+		}
+		bombe::StopReader reader(args[0]);
+		args = args.subspan(1);
+		const auto options = bombe::cli::parseOptions(args);
+		const bool csv = options.contains("csv");
+
+		if(csv)
+		{
+			std::cout << bombe::STOP_CSV_HEADER << '\n';
+		}
+
+		std::vector<bombe::Stop> stops(4096);
+		std::array<char, bombe::MAX_STOP_TEXT_SIZE + 1> text;
+		for(size_t num_stops; (num_stops = reader.read(stops)) > 0;)
+		{
+			for(const auto& stop : std::span(stops).first(num_stops))
+			{
+				const auto line = std::span(text).first<bombe::MAX_STOP_TEXT_SIZE>();
+				const size_t size = csv ? bombe::formatStopCsv(stop, line) : bombe::formatStopText(stop, line);
+				text[size] = '\n';
+				std::cout.write(text.data(), size + 1);
+			}
+		}
+
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
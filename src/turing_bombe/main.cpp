@@ -1,13 +1,17 @@
 #include "bombe.h"
 #include "cli_tools.h"
+#include "loop_index.h"
+#include "menu_screen.h"
 
 #include <chrono>
+#include <optional>
 
 namespace {
 
 std::string usageSyntax()
 {
-	return "Using: turing_bombe <menufile> <UKW> <R1> <R2> <R3> [R4]";
+	return "Using: turing_bombe <menufile> <UKW> <R1> <R2> <R3> [R4] [--stops=<file>] [--positions=<spec>] "
+	       "[--loop-screen] [--perf] [--traversal=<blocked|position>] [--turnovers=<letters>] [--cascade]";
 }
 
 } // anonymous namespace
@@ -21,17 +25,88 @@ int main(int argc, char** argv)
 		const auto num_rotors = menu.numRotors();
 		const auto reflector_model = bombe::cli::parseReflectorModel(args, num_rotors);
 		const auto rotor_models = bombe::cli::parseRotorModels(args, num_rotors);
+		const auto options = bombe::cli::parseOptions(args);
 
 		bombe::Bombe my_bombe(menu, reflector_model, rotor_models);
+		my_bombe.setSearchSpace(bombe::cli::searchSpaceOption(options, num_rotors));
+		if(const auto it = options.find("traversal"); it != options.end())
+		{
+			if((it->second != "blocked") && (it->second != "position"))
+			{
+				throw std::invalid_argument("Invalid traversal " + it->second);
+			}
+			my_bombe.setTraversal((it->second == "position") ? bombe::Bombe::Traversal::POSITION_MAJOR
+			                                                 : bombe::Bombe::Traversal::BLOCKED);
+		}
+		if(const auto it = options.find("turnovers"); it != options.end())
+		{
+			if(options.contains("loop-screen") || options.contains("cascade"))
+			{
+				throw std::invalid_argument("Screens only cover the menu as written, not turnover hypotheses");
+			}
+			my_bombe.setTurnoverHypotheses(bombe::parseLetterRanges(it->second));
+		}
+		if(options.contains("loop-screen") && options.contains("cascade"))
+		{
+			throw std::invalid_argument("Choose either the loop screen or the cascade");
+		}
+		std::optional<bombe::PerfCounters> perf_counters;
+		bombe::PerfProfile perf_profile;
+		if(options.contains("perf"))
+		{
+			perf_counters.emplace();
+			my_bombe.setProfiler(&*perf_counters, &perf_profile);
+		}
 
 		const auto tic = std::chrono::steady_clock::now();
-		const auto& stops = my_bombe.run();
+		// Screening only pays off when the register has loops (two for the cascade)
+		const bool loop_screen = options.contains("loop-screen") && !bombe::findRegisterLoops(menu).empty();
+		std::vector<uint32_t> candidates;
+		if(loop_screen)
+		{
+			bombe::LoopIndex loop_index(reflector_model, rotor_models);
+			candidates = loop_index.candidates(menu);
+			std::cout << "Loop screen leaves " << candidates.size() << " of " << bombe::numPositions(num_rotors)
+					  << " positions\n";
+		}
+		std::optional<bombe::MenuScreen> menu_screen;
+		if(options.contains("cascade"))
+		{
+			menu_screen.emplace(menu, reflector_model, rotor_models);
+		}
+		const bool cascade = menu_screen && menu_screen->active();
+		if(cascade)
+		{
+			menu_screen->setSearchSpace(bombe::cli::searchSpaceOption(options, num_rotors));
+			candidates = menu_screen->candidates();
+			std::cout << "Cascade screen (" << menu_screen->screenMenu().edges.size() << " of " << menu.edges.size()
+					  << " edges) leaves " << candidates.size() << " of " << bombe::numPositions(num_rotors)
+					  << " positions\n";
+		}
+		const auto& stops = (loop_screen || cascade) ? my_bombe.runPositions(candidates) : my_bombe.run();
 		const auto duration =
 			std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - tic).count();
 
 		std::cout << "Bombe run takes " << duration << " sec\n";
+		if(perf_counters)
+		{
+			std::cout << "Perf propagation: "
+					  << bombe::formatPerfCounts(perf_profile.propagation, perf_profile.num_positions, *perf_counters)
+					  << '\n';
+			std::cout << "Perf stepping: "
+					  << bombe::formatPerfCounts(perf_profile.stepping, perf_profile.num_positions, *perf_counters)
+					  << '\n';
+		}
 
-		bombe::cli::printStops(stops);
+		if(const auto it = options.find("stops"); it != options.end())
+		{
+			bombe::StopWriter writer(it->second);
+			writer.write(stops);
+		}
+		else
+		{
+			bombe::cli::printStops(stops);
+		}
 
 		return 0;
 	}
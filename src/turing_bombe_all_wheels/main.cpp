@@ -1,23 +1,127 @@
 #include "bombe.h"
 #include "cli_tools.h"
+#include "loop_index.h"
+#include "thread_affinity.h"
+#include "wheel_orders.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
 #include <fstream>
 #include <future>
+#include <iomanip>
+#include <mutex>
+#include <optional>
 
 namespace {
 
 std::string usageSyntax()
 {
-	return "Using: turing_bombe_all_wheels <menufile> <threads>";
+	return "Using: turing_bombe_all_wheels <menufile> <threads> [--pin] [--stops=<file>] [--positions=<spec>] "
+	       "[--rules=<rules>] [--rules-file=<file>] "
+	       "[--loop-screen] [--progress[=<sec>]] [--status=<file>] [--perf]";
 }
 
-size_t numRotorPermulations(size_t pool_size)
+// Set by SIGINT/SIGTERM, polled by the workers
+std::atomic<bool> g_cancelled{false};
+
+extern "C" void onCancelSignal(int)
 {
-	return pool_size * (pool_size - 1) * (pool_size - 2);
+	g_cancelled.store(true);
 }
 
+// Periodically samples the per-worker position counters, printing throughput, percentage and ETA
+class ProgressReporter
+{
+public:
+	ProgressReporter(std::span<const std::atomic<uint64_t>> counters,
+	                 uint64_t total_positions,
+	                 std::chrono::duration<double> interval,
+	                 std::string status_filename)
+		: counters_{counters}
+		, total_positions_{total_positions}
+		, interval_{interval}
+		, status_filename_{std::move(status_filename)}
+		, start_time_{std::chrono::steady_clock::now()}
+		, thread_{&ProgressReporter::loop, this}
+	{
+	}
+
+	~ProgressReporter()
+	{
+		{
+			std::lock_guard lock(mutex_);
+			finished_ = true;
+		}
+		condition_.notify_one();
+		thread_.join();
+		report(g_cancelled ? "cancelled" : "done");
+	}
+
+private:
+	void loop()
+	{
+		std::unique_lock lock(mutex_);
+		while(!condition_.wait_for(lock, interval_, [this] { return finished_; }))
+		{
+			report("running");
+		}
+	}
+
+	void report(std::string_view state) const
+	{
+		uint64_t positions = 0;
+		for(const auto& counter : counters_)
+		{
+			positions += counter.load(std::memory_order_relaxed);
+		}
+
+		const double elapsed =
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+		const double rate = (elapsed > 0) ? (positions / elapsed) : 0;
+		const double percent = 100.0 * positions / total_positions_;
+		const auto eta = static_cast<uint64_t>((rate > 0) ? ((total_positions_ - positions) / rate) : 0);
+
+		std::ostringstream eta_text;
+		eta_text << eta / 3600 << ':' << std::setfill('0') << std::setw(2) << (eta / 60) % 60 << ':' << std::setw(2)
+				 << eta % 60;
+		std::cerr << "Progress: " << std::fixed << std::setprecision(1) << percent << "% (" << positions << '/'
+				  << total_positions_ << " positions), " << std::setprecision(0) << rate << " positions/s, ETA "
+				  << eta_text.str() << '\n';
+
+		if(!status_filename_.empty())
+		{
+			// Write and rename, so readers never see a partial file
+			const std::string tmp_filename = status_filename_ + ".tmp";
+			{
+				std::ofstream ofs(tmp_filename);
+				ofs << "state=" << state << '\n';
+				ofs << "positions=" << positions << '\n';
+				ofs << "total_positions=" << total_positions_ << '\n';
+				ofs << "percent=" << std::fixed << std::setprecision(2) << percent << '\n';
+				ofs << "positions_per_sec=" << std::setprecision(0) << rate << '\n';
+				ofs << "elapsed_sec=" << std::setprecision(0) << elapsed << '\n';
+				ofs << "eta_sec=" << eta << '\n';
+			}
+			std::rename(tmp_filename.c_str(), status_filename_.c_str());
+		}
+	}
+
+private:
+	std::span<const std::atomic<uint64_t>> counters_;
+	const uint64_t total_positions_;
+	const std::chrono::duration<double> interval_;
+	const std::string status_filename_;
+	const std::chrono::steady_clock::time_point start_time_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool finished_{false};
+	std::thread thread_;
+};
+
 auto allocateLoads(size_t total, size_t num_threads)
 {
 	const size_t div = total / num_threads;
@@ -29,79 +133,27 @@ auto allocateLoads(size_t total, size_t num_threads)
 	return loads;
 }
 
-using ThreadWorks = std::vector<std::pair<bombe::ReflectorModel, std::vector<bombe::RotorModel>>>;
+using ThreadWorks = std::vector<bombe::WheelOrder>;
 
-auto generateThreadWorks(size_t num_rotors, size_t num_threads)
+auto generateThreadWorks(const bombe::WheelOrderRules& rules, size_t num_threads)
 {
 	std::vector<ThreadWorks> works(1);
 
-	if(num_rotors == 3)
+	const auto wheel_orders = bombe::enumerateWheelOrders(rules);
+	if(wheel_orders.empty())
 	{
-		std::vector<bombe::ReflectorModel> reflector_pool = {bombe::ReflectorModel::REGULAR_B,
-		                                                     bombe::ReflectorModel::REGULAR_C};
-		std::vector<bombe::RotorModel> rotor_pool = {bombe::RotorModel::M_I,
-		                                             bombe::RotorModel::M_II,
-		                                             bombe::RotorModel::M_III,
-		                                             bombe::RotorModel::M_IV,
-		                                             bombe::RotorModel::M_V};
-		const auto loads = allocateLoads(numRotorPermulations(rotor_pool.size()) * reflector_pool.size(), num_threads);
-		for(const auto reflector : reflector_pool)
-		{
-			auto rotors = rotor_pool;
-			do
-			{
-				if(works.back().size() >= loads[works.size() - 1])
-				{
-					works.emplace_back();
-				}
-				auto& work = works.back().emplace_back();
-				work.first = reflector;
-				work.second.resize(3);
-				std::copy(rotors.begin(), rotors.begin() + 3, work.second.begin());
-				std::reverse(rotors.begin() + 3, rotors.end());
-			} while(std::next_permutation(rotors.begin(), rotors.end()));
-		}
-	}
-	else if(num_rotors == 4)
-	{
-		std::vector<bombe::ReflectorModel> reflector_pool = {bombe::ReflectorModel::THIN_B,
-		                                                     bombe::ReflectorModel::THIN_C};
-		std::vector<bombe::RotorModel> thin_rotor_pool = {bombe::RotorModel::M_BETA, bombe::RotorModel::M_GAMMA};
-		std::vector<bombe::RotorModel> rotor_pool = {bombe::RotorModel::M_I,
-		                                             bombe::RotorModel::M_II,
-		                                             bombe::RotorModel::M_III,
-		                                             bombe::RotorModel::M_IV,
-		                                             bombe::RotorModel::M_V,
-		                                             bombe::RotorModel::M_VI,
-		                                             bombe::RotorModel::M_VII,
-		                                             bombe::RotorModel::M_VIII};
-		const auto loads = allocateLoads(
-			numRotorPermulations(rotor_pool.size()) * reflector_pool.size() * thin_rotor_pool.size(), num_threads);
-		for(const auto reflector : reflector_pool)
-		{
-			for(const auto thin_rotor : thin_rotor_pool)
-			{
-				auto rotors = rotor_pool;
-				do
-				{
-					if(works.back().size() >= loads[works.size() - 1])
-					{
-						works.emplace_back();
-					}
-					auto& work = works.back().emplace_back();
-					work.first = reflector;
-					work.second.resize(4);
-					work.second[0] = thin_rotor;
-					std::copy(rotors.begin(), rotors.begin() + 3, work.second.begin() + 1);
-					std::reverse(rotors.begin() + 3, rotors.end());
-				} while(std::next_permutation(rotors.begin(), rotors.end()));
-			}
-		}
+		throw std::invalid_argument("No wheel order satisfies the rules");
 	}
-	else
+	const auto loads = allocateLoads(wheel_orders.size(), num_threads);
+	for(const auto& wheel_order : wheel_orders)
 	{
-		throw std::invalid_argument("Invalid number of rotors");
+		if(works.back().size() >= loads[works.size() - 1])
+		{
+			works.emplace_back();
+		}
+		works.back().push_back(wheel_order);
 	}
+	works.resize(num_threads); // with fewer wheel orders than threads, some threads stay idle
 
 #if 1
 	std::cout << "Work allocation:\n";
@@ -129,14 +181,59 @@ auto generateThreadWorks(size_t num_rotors, size_t num_threads)
 	return works;
 }
 
-std::vector<bombe::Bombe::Stop> threadProcessing(const bombe::Bombe::Menu& menu, ThreadWorks&& works)
+std::vector<bombe::Bombe::Stop> threadProcessing(const bombe::Bombe::Menu& shared_menu,
+                                                 ThreadWorks&& shared_works,
+                                                 const bombe::SearchSpace& search_space,
+                                                 bool loop_screen,
+                                                 std::optional<size_t> cpu,
+                                                 std::atomic<uint64_t>& position_counter,
+                                                 std::vector<bombe::PerfProfile>* perf_profiles)
 {
+	if(cpu && !bombe::pinCurrentThread(*cpu))
+	{
+		std::cerr << "Cannot pin thread to CPU " << *cpu << "\n";
+	}
+
+	// Everything below is allocated after pinning, so first-touch places it on the local NUMA node
+	const bombe::Bombe::Menu menu = shared_menu;
+	const ThreadWorks works = shared_works;
 	std::vector<bombe::Bombe::Stop> all_stops;
 
-	for(const auto& work : works)
+	// Counters must be opened by the worker itself, as they count the calling thread
+	std::optional<bombe::PerfCounters> perf_counters;
+	if(perf_profiles != nullptr)
+	{
+		perf_counters.emplace();
+		perf_profiles->resize(works.size());
+	}
+
+	// One bombe per worker, reconfigured for each wheel order
+	std::optional<bombe::Bombe> my_bombe;
+	for(size_t work_idx = 0; work_idx < works.size(); ++work_idx)
 	{
-		bombe::Bombe my_bombe(menu, work.first, work.second);
-		const auto& stops = my_bombe.run();
+		const auto& work = works[work_idx];
+		if(g_cancelled)
+		{
+			break;
+		}
+
+		if(my_bombe)
+		{
+			my_bombe->reconfigure(work.first, work.second);
+		}
+		else
+		{
+			my_bombe.emplace(menu, work.first, work.second);
+			my_bombe->setSearchSpace(search_space);
+			my_bombe->setMonitor(&position_counter, &g_cancelled);
+		}
+		if(perf_counters)
+		{
+			my_bombe->setProfiler(&*perf_counters, &(*perf_profiles)[work_idx]);
+		}
+		const auto& stops = loop_screen
+			? my_bombe->runPositions(bombe::LoopIndex(work.first, work.second).candidates(menu))
+			: my_bombe->run();
 		const size_t old_size = all_stops.size();
 		all_stops.resize(old_size + stops.size());
 		std::copy(stops.begin(), stops.end(), all_stops.begin() + old_size);
@@ -145,6 +242,50 @@ std::vector<bombe::Bombe::Stop> threadProcessing(const bombe::Bombe::Menu& menu,
 	return all_stops;
 }
 
+std::string formatWheelOrder(const bombe::WheelOrder& wheel_order)
+{
+	std::string text = std::to_string(int(wheel_order.first));
+	for(const auto rotor : wheel_order.second)
+	{
+		text += ' ' + std::to_string(int(rotor));
+	}
+	return text;
+}
+
+// Propagation and stepping counts per wheel order and per thread (wheel orders a cancelled run never reached are
+// skipped)
+void printPerfProfiles(std::span<const ThreadWorks> thread_works,
+                       std::span<const std::vector<bombe::PerfProfile>> perf_profiles)
+{
+	// Only to learn which events this machine provides
+	const bombe::PerfCounters counters;
+	const auto print = [&](const std::string& label, const bombe::PerfProfile& profile) {
+		std::cout << "Perf " << label << ": propagation "
+				  << bombe::formatPerfCounts(profile.propagation, profile.num_positions, counters) << "; stepping "
+				  << bombe::formatPerfCounts(profile.stepping, profile.num_positions, counters) << '\n';
+	};
+
+	for(size_t thread_idx = 0; thread_idx < perf_profiles.size(); ++thread_idx)
+	{
+		for(size_t work_idx = 0; work_idx < perf_profiles[thread_idx].size(); ++work_idx)
+		{
+			if(perf_profiles[thread_idx][work_idx].num_positions > 0)
+			{
+				print(formatWheelOrder(thread_works[thread_idx][work_idx]), perf_profiles[thread_idx][work_idx]);
+			}
+		}
+	}
+	for(size_t thread_idx = 0; thread_idx < perf_profiles.size(); ++thread_idx)
+	{
+		bombe::PerfProfile total;
+		for(const auto& profile : perf_profiles[thread_idx])
+		{
+			total += profile;
+		}
+		print("thread #" + std::to_string(thread_idx + 1), total);
+	}
+}
+
 } // anonymous namespace
 
 int main(int argc, char** argv)
@@ -159,17 +300,90 @@ int main(int argc, char** argv)
 			throw std::invalid_argument("Cannot parse number of threads");
 		}
 		const size_t num_threads = std::stoi(args[0]);
+		args = args.subspan(1);
+		const auto options = bombe::cli::parseOptions(args);
+
+		// Pin worker threads in CPU order, so consecutive workers share a socket
+		std::vector<size_t> cpus;
+		if(options.contains("pin"))
+		{
+			cpus = bombe::availableCpus();
+			if(cpus.empty())
+			{
+				std::cerr << "Thread pinning is not supported\n";
+			}
+		}
+
+		bombe::WheelOrderRules rules(menu.numRotors());
+		if(const auto it = options.find("rules-file"); it != options.end())
+		{
+			rules.loadRules(it->second);
+		}
+		if(const auto it = options.find("rules"); it != options.end())
+		{
+			rules.parseRules(it->second);
+		}
+		auto thread_works = generateThreadWorks(rules, num_threads);
+		size_t num_wheel_orders = 0;
+		for(const auto& works : thread_works)
+		{
+			num_wheel_orders += works.size();
+		}
+		const auto search_space = bombe::cli::searchSpaceOption(options, menu.numRotors());
+		const uint64_t positions_per_wheel_order = search_space.size(menu.numRotors());
+		// Screening only pays off when the register has loops
+		const bool loop_screen = options.contains("loop-screen") && !bombe::findRegisterLoops(menu).empty();
+
+		// Stop gracefully on Ctrl-C, keeping the stops found so far
+		std::signal(SIGINT, onCancelSignal);
+		std::signal(SIGTERM, onCancelSignal);
+
+		std::vector<std::atomic<uint64_t>> position_counters(num_threads);
+		std::optional<ProgressReporter> reporter;
+		const auto progress_it = options.find("progress");
+		const auto status_it = options.find("status");
+		if((progress_it != options.end()) || (status_it != options.end()))
+		{
+			const double interval =
+				((progress_it != options.end()) && !progress_it->second.empty()) ? std::stod(progress_it->second) : 10;
+			reporter.emplace(position_counters,
+			                 num_wheel_orders * positions_per_wheel_order,
+			                 std::chrono::duration<double>(interval),
+			                 (status_it != options.end()) ? status_it->second : "");
+		}
+
+		// Per thread, one profile per wheel order of the thread
+		const bool perf = options.contains("perf");
+		std::vector<std::vector<bombe::PerfProfile>> perf_profiles(num_threads);
+		const auto thread_works_copy = perf ? thread_works : std::vector<ThreadWorks>{};
 
-		auto thread_works = generateThreadWorks(menu.numRotors(), num_threads);
 		std::vector<std::thread> threads;
 		std::vector<std::future<std::vector<bombe::Bombe::Stop>>> results;
 		const auto tic = std::chrono::steady_clock::now();
 		for(size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
 		{
-			std::packaged_task<std::vector<bombe::Bombe::Stop>(const bombe::Bombe::Menu&, ThreadWorks&&)> task(
-				&threadProcessing);
+			std::packaged_task<std::vector<bombe::Bombe::Stop>(const bombe::Bombe::Menu&,
+			                                                   ThreadWorks&&,
+			                                                   const bombe::SearchSpace&,
+			                                                   bool,
+			                                                   std::optional<size_t>,
+			                                                   std::atomic<uint64_t>&,
+			                                                   std::vector<bombe::PerfProfile>*)>
+				task(&threadProcessing);
 			results.push_back(task.get_future());
-			threads.emplace_back(std::move(task), std::ref(menu), std::move(thread_works[thread_idx]));
+			std::optional<size_t> cpu;
+			if(!cpus.empty())
+			{
+				cpu = cpus[thread_idx % cpus.size()];
+			}
+			threads.emplace_back(std::move(task),
+			                     std::ref(menu),
+			                     std::move(thread_works[thread_idx]),
+			                     std::cref(search_space),
+			                     loop_screen,
+			                     cpu,
+			                     std::ref(position_counters[thread_idx]),
+			                     perf ? &perf_profiles[thread_idx] : nullptr);
 		}
 
 		std::vector<bombe::Bombe::Stop> all_stops;
@@ -183,10 +397,29 @@ int main(int argc, char** argv)
 		}
 		const auto duration =
 			std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - tic).count();
+		reporter.reset();
 
 		//bombe::cli::printStops(all_stops);
+		if(const auto it = options.find("stops"); it != options.end())
+		{
+			bombe::StopWriter writer(it->second);
+			writer.write(all_stops);
+		}
+		if(g_cancelled)
+		{
+			// Without a stop file, the partial sweep would otherwise leave nothing to resume from
+			std::cout << "Cancelled, keeping the stops found so far\n";
+			if(!options.contains("stops"))
+			{
+				bombe::cli::printStops(all_stops);
+			}
+		}
 		std::cout << "Total " << all_stops.size() << " stops\n";
 		std::cout << "All bombe runs take " << duration << " sec\n";
+		if(perf)
+		{
+			printPerfProfiles(thread_works_copy, perf_profiles);
+		}
 
 		return 0;
 	}
@@ -0,0 +1,86 @@
+#include "cli_tools.h"
+#include "reflector_search.h"
+
+#include <chrono>
+
+namespace {
+
+std::string usageSyntax()
+{
+	return "Using: ukw_d_bombe <menufile> <R1> <R2> <R3> [--known-pairs=<pairs>] [--positions=<spec>] "
+	       "[--node-limit=<n>] [--stops=<file>]";
+}
+
+// Deduced reflector pairs, e.g. "AQ:BO:CW"
+std::string formatPairs(const bombe::SingleMap& pairs)
+{
+	std::string text;
+	for(bombe::Letter letter = 0; letter < bombe::NUM_LETTERS; ++letter)
+	{
+		if((pairs[letter] != bombe::ReflectorSearch::NO_PAIR) && (letter < pairs[letter]))
+		{
+			text += std::string(text.empty() ? "" : ":");
+			text += {bombe::letter2Char(letter), bombe::letter2Char(pairs[letter])};
+		}
+	}
+	return text;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::span<const char* const> args(argv + 1, argc - 1);
+		const auto menu = bombe::cli::parseMenu(args);
+		if(menu.numRotors() != 3)
+		{
+			throw std::invalid_argument("The UKW-D bombe needs a three-rotor menu");
+		}
+		const auto rotor_models = bombe::cli::parseRotorModels(args, 3);
+		const auto options = bombe::cli::parseOptions(args);
+
+		bombe::ReflectorSearch search(menu, rotor_models);
+		search.setSearchSpace(bombe::cli::searchSpaceOption(options, 3));
+		if(const auto it = options.find("known-pairs"); it != options.end())
+		{
+			search.setKnownPairs(it->second);
+		}
+		search.setNodeLimit(bombe::cli::optionValue(options, "node-limit", 100000));
+
+		const auto tic = std::chrono::steady_clock::now();
+		const auto& results = search.run();
+		const auto duration =
+			std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - tic).count();
+		std::cout << "UKW-D bombe run takes " << duration << " sec\n";
+
+		if(const auto it = options.find("stops"); it != options.end())
+		{
+			std::vector<bombe::Stop> stops;
+			for(const auto& result : results)
+			{
+				stops.push_back(result.stop);
+			}
+			bombe::StopWriter writer(it->second);
+			writer.write(stops);
+		}
+		else
+		{
+			std::array<char, bombe::MAX_STOP_TEXT_SIZE> text;
+			for(const auto& result : results)
+			{
+				std::cout.write(text.data(), bombe::formatStopText(result.stop, text));
+				std::cout << "  " << (result.undecided ? "undecided" : formatPairs(result.pairs)) << '\n';
+			}
+		}
+
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "EXCEPTION: " << e.what() << '\n';
+		std::cout << usageSyntax() << "\n";
+		return -1;
+	}
+}
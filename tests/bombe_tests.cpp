@@ -0,0 +1,543 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "bombe.h"
+#include "job_queue.h"
+#include "loop_index.h"
+#include "menu_analysis.h"
+#include "menu_screen.h"
+#include "reflector_search.h"
+#include "wheel_orders.h"
+#include "workload.h"
+
+#include <numeric>
+
+namespace {
+
+const std::vector<std::string> MENU_LINES = {
+	"ZZABE", "ZZBED", "ZZCAB", "ZZDCG", "ZZEHE", "ZZFHA", "ZZGEH", "ZZHAD", "ZZIDB", "=E=A=", "+++++"};
+
+// Seed of the generated workloads and random inputs
+constexpr uint64_t FIXTURE_SEED = 1234;
+
+std::vector<std::string> formatStops(std::span<const bombe::Stop> stops)
+{
+	std::vector<std::string> lines;
+	std::array<char, bombe::MAX_STOP_TEXT_SIZE> text;
+	for(const auto& stop : stops)
+	{
+		lines.emplace_back(text.data(), bombe::formatStopText(stop, text));
+	}
+	return lines;
+}
+
+std::vector<std::string> runBombe(const bombe::Bombe::Menu& menu,
+                                  bombe::ReflectorModel reflector_model,
+                                  std::span<const bombe::RotorModel> rotor_models)
+{
+	bombe::Bombe my_bombe(menu, reflector_model, rotor_models);
+	return formatStops(my_bombe.run());
+}
+
+} // anonymous namespace
+
+TEST_CASE("Stop record encoding")
+{
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_GAMMA, bombe::RotorModel::M_VIII, bombe::RotorModel::M_I, bombe::RotorModel::M_V};
+	std::vector<bombe::RotorModel> decoded_models(rotor_models.size());
+	bombe::decodeWheelOrder(bombe::encodeWheelOrder(rotor_models), decoded_models);
+	DOCTEST_CHECK(decoded_models == rotor_models);
+
+	const std::vector<bombe::Letter> positions = {25, 0, 13, 7};
+	std::vector<bombe::Letter> decoded_positions(positions.size());
+	bombe::decodePositions(bombe::encodePositions(positions), decoded_positions);
+	DOCTEST_CHECK(decoded_positions == positions);
+}
+
+TEST_CASE("Bit matrix transpose")
+{
+	bombe::BitMatrix matrix;
+	for(uint32_t row = 0; row < 32; ++row)
+	{
+		matrix[row] = (row * 0x9E3779B9u) ^ (row << 7);
+	}
+	bombe::BitMatrix transposed = matrix;
+	bombe::transpose(transposed);
+
+	for(uint32_t row = 0; row < 32; ++row)
+	{
+		for(uint32_t col = 0; col < 32; ++col)
+		{
+			DOCTEST_CHECK_EQ((matrix[row] >> col) & 1, (transposed[col] >> row) & 1);
+		}
+	}
+}
+
+TEST_CASE("Bombe stops for data/menu.txt")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+	const auto stops = runBombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+	DOCTEST_CHECK_EQ(stops, std::vector<std::string>{"1 2 1 3    BGX E:X"});
+}
+
+TEST_CASE("Reconfigured bombe matches a new bombe")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const std::vector<bombe::RotorModel> first_models = {
+		bombe::RotorModel::M_V, bombe::RotorModel::M_IV, bombe::RotorModel::M_III};
+	const std::vector<bombe::RotorModel> second_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+
+	bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_C, first_models);
+	my_bombe.run();
+	my_bombe.reconfigure(bombe::ReflectorModel::REGULAR_B, second_models);
+	DOCTEST_CHECK_EQ(formatStops(my_bombe.run()), runBombe(menu, bombe::ReflectorModel::REGULAR_B, second_models));
+}
+
+TEST_CASE("Single position tests match a full run")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+	bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+
+	std::vector<bombe::Stop> stops;
+	std::array<bombe::Letter, 3> rotor_offsets{};
+	for(size_t position = 0; position < bombe::numPositions(3); ++position)
+	{
+		bombe::decodePositions(static_cast<uint32_t>(position), rotor_offsets);
+		if(const auto stop = my_bombe.test(rotor_offsets))
+		{
+			stops.push_back(*stop);
+		}
+	}
+	DOCTEST_CHECK_EQ(formatStops(stops), std::vector<std::string>{"1 2 1 3    BGX E:X"});
+
+	// A full run after test() is unaffected
+	DOCTEST_CHECK_EQ(runBombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models).size(), my_bombe.run().size());
+}
+
+TEST_CASE("Profiled bombe run keeps its stops")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+	bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+	const bombe::PerfCounters counters;
+	bombe::PerfProfile profile;
+	my_bombe.setProfiler(&counters, &profile);
+
+	DOCTEST_CHECK_EQ(formatStops(my_bombe.run()), std::vector<std::string>{"1 2 1 3    BGX E:X"});
+	DOCTEST_CHECK_EQ(profile.num_positions, bombe::numPositions(3));
+	if(counters.counts(&bombe::PerfCounts::task_clock_ns))
+	{
+		DOCTEST_CHECK(profile.propagation.task_clock_ns > 0);
+	}
+}
+
+TEST_CASE("Blocked traversal matches position-major stops")
+{
+	// A short menu without loops, for plenty of stops
+	bombe::WorkloadGenerator generator(FIXTURE_SEED);
+	bombe::WorkloadSpec spec;
+	spec.menu_length = 7;
+	spec.num_loops = 0;
+	const auto workload = generator.generate(spec);
+	bombe::Bombe my_bombe(workload.menu, workload.reflector_model, workload.rotor_models);
+
+	const auto runStops = [&](bombe::Bombe::Traversal traversal) {
+		my_bombe.setTraversal(traversal);
+		return formatStops(my_bombe.run());
+	};
+	const auto blocked = runStops(bombe::Bombe::Traversal::BLOCKED);
+	DOCTEST_CHECK(blocked.size() > 10);
+	DOCTEST_CHECK_EQ(blocked, runStops(bombe::Bombe::Traversal::POSITION_MAJOR));
+
+	// Partial fast rotor revolutions
+	my_bombe.setSearchSpace(bombe::parseSearchSpace("*,A-M,BDF-Q", 3));
+	DOCTEST_CHECK_EQ(runStops(bombe::Bombe::Traversal::BLOCKED), runStops(bombe::Bombe::Traversal::POSITION_MAJOR));
+}
+
+TEST_CASE("Turnover hypotheses match menus rewritten with the middle rotor stepped")
+{
+	// A short menu for plenty of stops; the middle rotor may step before its third or its fifth letter
+	const std::vector<std::string> lines = {"ZZABE", "ZZBED", "ZZCAB", "ZZDCG", "ZZEHE", "ZZFHA", "=E=A=", "+++++"};
+	const std::vector<std::string> lines_c = {"ZZABE", "ZZBED", "ZACAB", "ZADCG", "ZAEHE", "ZAFHA", "=E=A=", "+++++"};
+	const std::vector<std::string> lines_e = {"ZZABE", "ZZBED", "ZZCAB", "ZZDCG", "ZAEHE", "ZAFHA", "=E=A=", "+++++"};
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+
+	const auto reflector_model = bombe::ReflectorModel::REGULAR_B;
+	std::vector<std::string> expected = runBombe(bombe::Bombe::loadMenu(lines), reflector_model, rotor_models);
+	for(const auto& [stepped_lines, tag] : {std::pair{lines_c, " T:C"}, std::pair{lines_e, " T:E"}})
+	{
+		for(const auto& line : runBombe(bombe::Bombe::loadMenu(stepped_lines), reflector_model, rotor_models))
+		{
+			expected.push_back(line + tag);
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	DOCTEST_CHECK(expected.size() > 10);
+
+	const auto menu = bombe::Bombe::loadMenu(lines);
+	bombe::Bombe my_bombe(menu, reflector_model, rotor_models);
+	my_bombe.setTurnoverHypotheses(bombe::parseLetterRanges("CE"));
+	const auto blocked = formatStops(my_bombe.run());
+	auto sorted = blocked;
+	std::sort(sorted.begin(), sorted.end());
+	DOCTEST_CHECK_EQ(sorted, expected);
+
+	my_bombe.setTraversal(bombe::Bombe::Traversal::POSITION_MAJOR);
+	DOCTEST_CHECK_EQ(formatStops(my_bombe.run()), blocked);
+	std::vector<uint32_t> offset_indices(bombe::numPositions(3));
+	std::iota(offset_indices.begin(), offset_indices.end(), 0);
+	DOCTEST_CHECK_EQ(formatStops(my_bombe.runPositions(offset_indices)), blocked);
+
+	// No turnover at the first edge, and back to the menu as written
+	DOCTEST_CHECK_THROWS_AS(my_bombe.setTurnoverHypotheses(bombe::parseLetterRanges("A")), std::invalid_argument);
+	my_bombe.setTurnoverHypotheses({});
+	DOCTEST_CHECK_EQ(formatStops(my_bombe.run()), runBombe(menu, reflector_model, rotor_models));
+
+	// A crib wrapping from Z to A, with the middle rotor stepping at A
+	const std::vector<std::string> wrapped_lines = {
+		"ZZXBE", "ZZYED", "ZZZAB", "ZZADC", "ZZBHE", "ZZCHA", "=E=A=", "+++++"};
+	const std::vector<std::string> wrapped_lines_a = {
+		"ZZXBE", "ZZYED", "ZZZAB", "ZAADC", "ZABHE", "ZACHA", "=E=A=", "+++++"};
+	std::vector<std::string> wrapped_expected =
+		runBombe(bombe::Bombe::loadMenu(wrapped_lines), reflector_model, rotor_models);
+	for(const auto& line : runBombe(bombe::Bombe::loadMenu(wrapped_lines_a), reflector_model, rotor_models))
+	{
+		wrapped_expected.push_back(line + " T:A");
+	}
+	std::sort(wrapped_expected.begin(), wrapped_expected.end());
+
+	const auto wrapped_menu = bombe::Bombe::loadMenu(wrapped_lines);
+	bombe::Bombe wrapped_bombe(wrapped_menu, reflector_model, rotor_models);
+	wrapped_bombe.setTurnoverHypotheses(bombe::parseLetterRanges("A"));
+	auto wrapped_sorted = formatStops(wrapped_bombe.run());
+	std::sort(wrapped_sorted.begin(), wrapped_sorted.end());
+	DOCTEST_CHECK_EQ(wrapped_sorted, wrapped_expected);
+}
+
+TEST_CASE("Turnover hypotheses reject menus they cannot step")
+{
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+	const auto reflector_model = bombe::ReflectorModel::REGULAR_B;
+	const auto hypotheses = bombe::parseLetterRanges("E");
+
+	// The middle rotor already steps within the menu
+	const std::vector<std::string> stepped_lines = {
+		"ZABOR", "ZZBOI", "ZZKIL", "ZZLAL", "ZZEAY", "ZAAEZ", "ZZAFE", "=F=I=", "+++++"};
+	const auto stepped_menu = bombe::Bombe::loadMenu(stepped_lines);
+	bombe::Bombe stepped_bombe(stepped_menu, reflector_model, rotor_models);
+	DOCTEST_CHECK_THROWS_AS(stepped_bombe.setTurnoverHypotheses(hypotheses), std::invalid_argument);
+
+	// The first edge is not the earliest crib letter
+	const std::vector<std::string> unordered_lines = {"ZZCAB", "ZZABE", "ZZBED", "ZZDCG", "ZZFHA", "=E=A=", "+++++"};
+	const auto unordered_menu = bombe::Bombe::loadMenu(unordered_lines);
+	bombe::Bombe unordered_bombe(unordered_menu, reflector_model, rotor_models);
+	DOCTEST_CHECK_THROWS_AS(unordered_bombe.setTurnoverHypotheses(hypotheses), std::invalid_argument);
+
+	// The same with a crib wrapping from Z to A, which starts at X
+	const std::vector<std::string> wrapped_lines = {
+		"ZZZAB", "ZZXBE", "ZZYED", "ZZADC", "ZZBHE", "ZZCHA", "=E=A=", "+++++"};
+	const auto wrapped_menu = bombe::Bombe::loadMenu(wrapped_lines);
+	bombe::Bombe wrapped_bombe(wrapped_menu, reflector_model, rotor_models);
+	DOCTEST_CHECK_THROWS_AS(wrapped_bombe.setTurnoverHypotheses(hypotheses), std::invalid_argument);
+}
+
+TEST_CASE("Job queue order and cancellation")
+{
+	using bombe::ReflectorModel;
+	using bombe::RotorModel;
+	using UnitOrder = std::vector<std::pair<uint64_t, RotorModel>>;
+
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const auto make_job = [&](uint64_t id, int priority) {
+		auto job = std::make_shared<bombe::QueuedJob>();
+		job->id = id;
+		job->priority = priority;
+		job->menu = menu;
+		return job;
+	};
+	const std::vector<bombe::WheelOrder> wheel_orders = {
+		{ReflectorModel::REGULAR_B, {RotorModel::M_I, RotorModel::M_II, RotorModel::M_III}},
+		{ReflectorModel::REGULAR_B, {RotorModel::M_II, RotorModel::M_I, RotorModel::M_III}},
+		{ReflectorModel::REGULAR_B, {RotorModel::M_III, RotorModel::M_II, RotorModel::M_I}}};
+	const auto pop_order = [](bombe::JobQueue& queue, size_t num_units) {
+		UnitOrder order;
+		for(size_t k = 0; k < num_units; ++k)
+		{
+			const auto unit = queue.pop();
+			order.emplace_back(unit->job->id, unit->wheel_order.second[0]);
+		}
+		return order;
+	};
+
+	// Higher priority first; jobs of equal priority take turns, each in its own wheel order sequence
+	bombe::JobQueue queue;
+	const auto job1 = make_job(1, 0);
+	const auto job2 = make_job(2, 0);
+	const auto job3 = make_job(3, 5);
+	queue.push(job1, wheel_orders);
+	queue.push(job2, std::span(wheel_orders).first(2));
+	queue.push(job3, std::span(wheel_orders).last(2));
+	DOCTEST_CHECK_EQ(queue.size(), size_t{7});
+	DOCTEST_CHECK_EQ(job1->num_pending, size_t{3});
+	const UnitOrder expected = {{3, RotorModel::M_II},
+	                            {3, RotorModel::M_III},
+	                            {1, RotorModel::M_I},
+	                            {2, RotorModel::M_I},
+	                            {1, RotorModel::M_II},
+	                            {2, RotorModel::M_II},
+	                            {1, RotorModel::M_III}};
+	DOCTEST_CHECK_EQ(pop_order(queue, 7), expected);
+
+	// Units of a job cancelled while queued are skipped and count as finished
+	queue.push(job1, wheel_orders);
+	queue.push(job2, wheel_orders);
+	job1->cancelled = true;
+	const UnitOrder expected_job2 = {{2, RotorModel::M_I}, {2, RotorModel::M_II}, {2, RotorModel::M_III}};
+	DOCTEST_CHECK_EQ(pop_order(queue, 3), expected_job2);
+	DOCTEST_CHECK_EQ(job1->num_pending, size_t{0});
+
+	// A job queued while another is half done takes turns with it instead of running first
+	const auto job5 = make_job(5, 0);
+	const auto job6 = make_job(6, 0);
+	queue.push(job5, wheel_orders);
+	DOCTEST_CHECK_EQ(pop_order(queue, 2), (UnitOrder{{5, RotorModel::M_I}, {5, RotorModel::M_II}}));
+	queue.push(job6, wheel_orders);
+	const UnitOrder expected_turns = {
+		{6, RotorModel::M_I}, {5, RotorModel::M_III}, {6, RotorModel::M_II}, {6, RotorModel::M_III}};
+	DOCTEST_CHECK_EQ(pop_order(queue, 4), expected_turns);
+
+	// M4 jobs are split by Greek rotor position; closing drops and cancels the queued units
+	auto m4_job = make_job(4, 0);
+	m4_job->menu = bombe::Bombe::loadMenu(std::vector<std::string>{"ZZZABE", "ZZZBED", "=E=A==", "++++++"});
+	m4_job->search_space.positions[0].reset().set(1).set(7);
+	const std::vector<bombe::WheelOrder> m4_wheel_orders = {
+		{ReflectorModel::THIN_B, {RotorModel::M_BETA, RotorModel::M_I, RotorModel::M_II, RotorModel::M_III}}};
+	queue.push(m4_job, m4_wheel_orders);
+	DOCTEST_CHECK_EQ(queue.size(), size_t{2});
+	queue.close();
+	DOCTEST_CHECK(m4_job->cancelled);
+	DOCTEST_CHECK_FALSE(queue.pop().has_value());
+}
+
+TEST_CASE("Rewirable reflector search stops at the true key")
+{
+	// UKW-D wiring with the fixed pair BO
+	constexpr std::string_view WIRING = "AQ:BO:CW:DY:EK:FL:GN:HU:IZ:JT:MX:PV:RS";
+	bombe::WorkloadGenerator generator(FIXTURE_SEED);
+	bombe::WorkloadSpec spec;
+	spec.menu_length = 20;
+	spec.num_loops = 6;
+	spec.crib_length = 26;
+	spec.reflector_wiring = WIRING;
+	const auto workload = generator.generate(spec);
+	DOCTEST_CHECK(workload.expected_stop.reflector_model == bombe::ReflectorModel::REWIRABLE_D);
+
+	// A whole fast rotor revolution at the true slow and middle positions
+	std::array<bombe::Letter, 3> positions;
+	workload.expected_stop.rotorPositions(positions);
+	std::string spec_text = {bombe::letter2Char(positions[0]), ',', bombe::letter2Char(positions[1]), ',', '*'};
+	bombe::ReflectorSearch search(workload.menu, workload.rotor_models);
+	search.setKnownPairs("BO");
+	search.setSearchSpace(bombe::parseSearchSpace(spec_text, 3));
+	const auto& results = search.run();
+
+	std::vector<bombe::Stop> stops;
+	const auto wiring = bombe::parseReflectorWiring(WIRING);
+	for(const auto& result : results)
+	{
+		stops.push_back(result.stop);
+		if((result.stop.position_index == workload.expected_stop.position_index) &&
+		   (result.stop.stecker == workload.expected_stop.stecker))
+		{
+			// The deduced pairs are those of the true wiring
+			DOCTEST_CHECK_FALSE(result.undecided);
+			for(bombe::Letter letter = 0; letter < bombe::NUM_LETTERS; ++letter)
+			{
+				const bombe::Letter paired = result.pairs[letter];
+				DOCTEST_CHECK(((paired == bombe::ReflectorSearch::NO_PAIR) || (paired == wiring[letter])));
+			}
+		}
+	}
+	DOCTEST_CHECK(bombe::containsStop(stops, workload.expected_stop));
+}
+
+TEST_CASE("Menu analysis of data/menu.txt")
+{
+	const auto statistics = bombe::analyzeMenu(bombe::Bombe::loadMenu(MENU_LINES));
+	DOCTEST_CHECK_EQ(statistics.num_rotors, 3);
+	DOCTEST_CHECK_EQ(statistics.num_letters, 7);
+	DOCTEST_CHECK_EQ(statistics.num_edges, 9);
+	DOCTEST_CHECK_EQ(statistics.num_components, 2);
+	DOCTEST_CHECK_EQ(statistics.num_closures, 4);
+	DOCTEST_CHECK_EQ(statistics.register_letters, 5);
+	DOCTEST_CHECK_EQ(statistics.register_edges, 8);
+	DOCTEST_CHECK_EQ(statistics.register_closures, 4);
+	DOCTEST_CHECK(bombe::estimateFalseStops(statistics) < 1);
+}
+
+TEST_CASE("Constrained search space")
+{
+	const auto search_space = bombe::parseSearchSpace("B,X-C,ACE-G", 3);
+	DOCTEST_CHECK_EQ(search_space.positions[0].count(), 1);
+	DOCTEST_CHECK_EQ(search_space.positions[1].count(), 6);
+	DOCTEST_CHECK_EQ(search_space.size(3), 30);
+	DOCTEST_CHECK(search_space.positions[1][bombe::char2Letter('A')]);
+	DOCTEST_CHECK_FALSE(search_space.positions[1][bombe::char2Letter('D')]);
+	DOCTEST_CHECK_THROWS_AS(bombe::parseSearchSpace("B,*", 3), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(bombe::parseSearchSpace("B,*,*,*", 3), std::invalid_argument);
+
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III};
+	bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+	my_bombe.setSearchSpace(bombe::parseSearchSpace("A-C,*,W-Y", 3));
+	DOCTEST_CHECK_EQ(my_bombe.run().size(), 1);
+	my_bombe.setSearchSpace(bombe::parseSearchSpace("C-A,*,*", 3));
+	DOCTEST_CHECK(my_bombe.run().empty());
+	my_bombe.setSearchSpace(bombe::SearchSpace());
+	DOCTEST_CHECK_EQ(my_bombe.run().size(), 1);
+}
+
+TEST_CASE("Loop index screening keeps all stops")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const auto loops = bombe::findRegisterLoops(menu);
+	DOCTEST_CHECK_EQ(loops.size(), bombe::analyzeMenu(menu).register_closures);
+	for(const auto& loop : loops)
+	{
+		// Closed walks from the register letter
+		const auto [l1, l2] = menu.edges[loop.front()].nodes;
+		const auto [l3, l4] = menu.edges[loop.back()].nodes;
+		const bombe::Letter reg_letter = menu.registers[0].first;
+		DOCTEST_CHECK(((l1 == reg_letter) || (l2 == reg_letter)) && ((l3 == reg_letter) || (l4 == reg_letter)));
+	}
+
+	const std::vector<std::vector<bombe::RotorModel>> wheel_orders = {
+		{bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III},
+		{bombe::RotorModel::M_V, bombe::RotorModel::M_III, bombe::RotorModel::M_IV},
+		{bombe::RotorModel::M_I, bombe::RotorModel::M_IV, bombe::RotorModel::M_II}};
+	for(const auto& rotor_models : wheel_orders)
+	{
+		bombe::LoopIndex loop_index(bombe::ReflectorModel::REGULAR_B, rotor_models);
+		const auto candidates = loop_index.candidates(menu);
+		DOCTEST_CHECK(candidates.size() < bombe::numPositions(3) / 10);
+
+		bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+		DOCTEST_CHECK_EQ(formatStops(my_bombe.runPositions(candidates)),
+		                 runBombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models));
+	}
+}
+
+TEST_CASE("Cascade screen keeps all stops")
+{
+	const auto menu = bombe::Bombe::loadMenu(MENU_LINES);
+	const auto screen_menu = bombe::selectScreenMenu(menu);
+	DOCTEST_CHECK(screen_menu.edges.size() < menu.edges.size());
+	DOCTEST_CHECK_EQ(bombe::analyzeMenu(screen_menu).register_closures, size_t{2});
+	for(const auto& rotor_models : std::vector<std::vector<bombe::RotorModel>>{
+			{bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III},
+			{bombe::RotorModel::M_V, bombe::RotorModel::M_III, bombe::RotorModel::M_IV}})
+	{
+		bombe::MenuScreen menu_screen(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+		const auto candidates = menu_screen.candidates();
+		DOCTEST_CHECK(candidates.size() < bombe::numPositions(3) / 10);
+
+		bombe::Bombe my_bombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models);
+		DOCTEST_CHECK_EQ(formatStops(my_bombe.runPositions(candidates)),
+		                 runBombe(menu, bombe::ReflectorModel::REGULAR_B, rotor_models));
+	}
+
+	// Generated menus, whose sub-menu starts at another edge, in a constrained search space
+	bombe::WorkloadGenerator generator(FIXTURE_SEED);
+	for(size_t num_loops = 2; num_loops <= 4; ++num_loops)
+	{
+		bombe::WorkloadSpec spec;
+		spec.menu_length = 14;
+		spec.num_loops = num_loops;
+		const auto workload = generator.generate(spec);
+		const auto search_space = bombe::parseSearchSpace("C-P,*,*", 3);
+		bombe::MenuScreen menu_screen(workload.menu, workload.reflector_model, workload.rotor_models);
+		DOCTEST_CHECK(menu_screen.active());
+		menu_screen.setSearchSpace(search_space);
+		const auto candidates = menu_screen.candidates();
+
+		bombe::Bombe my_bombe(workload.menu, workload.reflector_model, workload.rotor_models);
+		my_bombe.setSearchSpace(search_space);
+		const auto full_lines = formatStops(my_bombe.run());
+		DOCTEST_CHECK_EQ(formatStops(my_bombe.runPositions(candidates)), full_lines);
+		DOCTEST_CHECK(candidates.size() < bombe::numPositions(3) / 10);
+	}
+}
+
+TEST_CASE("Wheel order rules")
+{
+	DOCTEST_CHECK_EQ(bombe::enumerateWheelOrders(bombe::WheelOrderRules(3)).size(), 2 * 60);
+	DOCTEST_CHECK_EQ(bombe::enumerateWheelOrders(bombe::WheelOrderRules(4)).size(), 2 * 2 * 336);
+
+	bombe::WheelOrderRules rules(4);
+	rules.parseRules("reflectors 1 # thin B only\ngreek 2; require 6 7 8; slot 4 8; exclude 1 2 6 7 8");
+	const auto wheel_orders = bombe::enumerateWheelOrders(rules);
+	// VIII in the right-most slot meets the requirement: 7 * 6 orders of the other slots, minus the excluded one
+	DOCTEST_CHECK_EQ(wheel_orders.size(), 41);
+	for(const auto& wheel_order : wheel_orders)
+	{
+		DOCTEST_CHECK(wheel_order.first == bombe::ReflectorModel::THIN_B);
+		DOCTEST_CHECK(wheel_order.second[0] == bombe::RotorModel::M_GAMMA);
+		DOCTEST_CHECK(wheel_order.second[3] == bombe::RotorModel::M_VIII);
+	}
+
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("slot 5 1"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("rotors 1 9"), std::invalid_argument);
+	// Greek rotors only in the greek rule and slot 1; no number wraps into another model
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("rotors 1 2 101"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("require 102"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("slot 2 101"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("rotors 1 2 357"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("greek 258"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("reflectors 257"), std::invalid_argument);
+	DOCTEST_CHECK_THROWS_AS(rules.parseRule("favourite 1"), std::invalid_argument);
+}
+
+TEST_CASE("Generated workloads stop at the true key")
+{
+	bombe::WorkloadGenerator generator(FIXTURE_SEED);
+	for(const auto& [menu_length, num_loops] : {std::pair<size_t, size_t>{10, 2}, {12, 0}, {14, 3}})
+	{
+		bombe::WorkloadSpec spec;
+		spec.menu_length = menu_length;
+		spec.num_loops = num_loops;
+		const auto workload = generator.generate(spec);
+		const auto statistics = bombe::analyzeMenu(workload.menu);
+		DOCTEST_CHECK_EQ(statistics.num_edges, spec.menu_length);
+		DOCTEST_CHECK_EQ(statistics.num_components, size_t{1});
+		DOCTEST_CHECK_EQ(statistics.num_closures, spec.num_loops);
+
+		const auto lines = bombe::formatMenu(workload.menu);
+		const auto menu = bombe::Bombe::loadMenu(lines);
+		DOCTEST_CHECK_EQ(bombe::formatMenu(menu), lines);
+
+		bombe::Bombe my_bombe(menu, workload.reflector_model, workload.rotor_models);
+		DOCTEST_CHECK(bombe::containsStop(my_bombe.run(), workload.expected_stop));
+	}
+
+	// M4, searching the true Greek rotor position only
+	bombe::WorkloadSpec spec;
+	spec.num_rotors = 4;
+	const auto workload = generator.generate(spec);
+	std::array<bombe::Letter, bombe::MAX_ROTORS> positions;
+	workload.expected_stop.rotorPositions(positions);
+	bombe::SearchSpace search_space;
+	search_space.positions[0].reset().set(positions[0]);
+	bombe::Bombe my_bombe(workload.menu, workload.reflector_model, workload.rotor_models);
+	my_bombe.setSearchSpace(search_space);
+	DOCTEST_CHECK(bombe::containsStop(my_bombe.run(), workload.expected_stop));
+}
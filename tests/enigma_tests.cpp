@@ -1,7 +1,16 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "banburismus.h"
 #include "enigma.h"
+#include "message_stream.h"
+#include "ring_recovery.h"
+#include "rotor_kernels.h"
+
+#include <random>
+
+// Seed of the random inputs
+constexpr uint64_t FIXTURE_SEED = 1234;
 
 std::string removeSpaces(std::string_view input)
 {
@@ -273,3 +282,331 @@ TEST_CASE_FIXTURE(EnigmaTestFixture, "PAGE_71_RQCA (Göteborg Enigma M3 intercep
 	runTest("BNXYWSBGZUCKNYFSUGJZITXDFCDIKTCIVWNOTQLULVEAPRYSOREHNMEKGQORTFTCHQTSCJYCYTBSFBFBAAADZCPGCTYFJUHXDCFV",
 	        "VONMNAAZWESTFUNKSRUCHEINSACHTVIERSECHSNICHTZUENTSCHLZWSSELNXNACHPRUEFENUNDNEUVERSQHLUESSEPTHERGEBENX");
 }
+
+TEST_CASE("Message stream round trip with a key per message")
+{
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_IV, bombe::RotorModel::M_V};
+	const auto encipher = [&](std::string_view steckers, std::string_view grundstellung, std::string_view text) {
+		bombe::Enigma enigma(bombe::ReflectorModel::REGULAR_B, rotor_models);
+		enigma.configureSteckers(steckers);
+		enigma.configureRotors("BUL", grundstellung);
+		std::string output(text.size(), ' ');
+		enigma.process(text, output);
+		return output;
+	};
+	const std::string cipher1 = encipher("", "BLA", "HELLOWORLD");
+	const std::string cipher2 = encipher("AV:BS:CG", "XYZ", "SECONDMESSAGE");
+
+	// Key lines "[steckers] <grun>", all messages with the same wheel order and rings
+	const auto run_stream = [&](std::string_view input, size_t chunk_size) {
+		bombe::Enigma enigma(bombe::ReflectorModel::REGULAR_B, rotor_models);
+		enigma.configureRotors("BUL", "AAA");
+		std::string output;
+		bombe::MessageStream stream(
+			enigma,
+			[](std::string_view key_line, bombe::Enigma& message_enigma) {
+				const size_t split = key_line.rfind(' ');
+				message_enigma.configureSteckers((split == std::string_view::npos) ? "" : key_line.substr(0, split));
+				message_enigma.configureRotors("BUL", key_line.substr(split + 1));
+			},
+			[&output](std::string_view text) { output.append(text); },
+			4);
+		for(size_t start = 0; start < input.size(); start += chunk_size)
+		{
+			stream.feed(input.substr(start, chunk_size));
+		}
+		stream.finish();
+		return output;
+	};
+
+	for(const size_t chunk_size : {size_t{1}, size_t{5}, size_t{1000}})
+	{
+		const std::string plain_input = "@BLA\nHELLO WORLD\n@AV:BS:CG XYZ\nSECOND\nMESSAGE\n";
+		DOCTEST_CHECK_EQ(run_stream(plain_input, chunk_size), cipher1 + "\n" + cipher2);
+		const std::string cipher_input = "@BLA\n" + cipher1 + "\n@AV:BS:CG XYZ\n" + cipher2;
+		DOCTEST_CHECK_EQ(run_stream(cipher_input, chunk_size), "HELLOWORLD\nSECONDMESSAGE");
+	}
+
+	// A key line at the end of the input without a line break is still applied, so an invalid one is reported
+	DOCTEST_CHECK_EQ(run_stream("@BLA\nHELLOWORLD\n@XYZ", 1000), cipher1 + "\n");
+	DOCTEST_CHECK_THROWS_AS(run_stream("@BLA\nHELLOWORLD\n@XY", 1000), std::invalid_argument);
+
+	// Invalid text neither steps the rotors nor writes any output
+	bombe::Enigma enigma(bombe::ReflectorModel::REGULAR_B, rotor_models);
+	enigma.configureRotors("BUL", "BLA");
+	std::string output(12, ' ');
+	DOCTEST_CHECK_THROWS_AS(enigma.process("HELLO WORLD!", output), std::invalid_argument);
+	DOCTEST_CHECK_EQ(output, std::string(12, ' '));
+	output.resize(10);
+	enigma.process("HELLOWORLD", output);
+	DOCTEST_CHECK_EQ(output, cipher1);
+}
+
+TEST_CASE("Seek and random-access maps match sequential stepping")
+{
+	struct Setting
+	{
+		bombe::ReflectorModel reflector_model;
+		std::vector<bombe::RotorModel> rotor_models;
+		std::string_view ringstellung;
+		std::string_view grundstellung;
+	};
+	const std::vector<Setting> settings = {
+		{bombe::ReflectorModel::REGULAR_B,
+		 {bombe::RotorModel::M_II, bombe::RotorModel::M_IV, bombe::RotorModel::M_V},
+		 "BUL",
+		 "BLA"},
+		{bombe::ReflectorModel::REGULAR_A,
+		 {bombe::RotorModel::M_II, bombe::RotorModel::M_I, bombe::RotorModel::M_III},
+		 "XMV",
+		 "ADU"},
+		{bombe::ReflectorModel::REGULAR_B,
+		 {bombe::RotorModel::M_III, bombe::RotorModel::M_VI, bombe::RotorModel::M_VIII},
+		 "AHM",
+		 "UZV"},
+		{bombe::ReflectorModel::THIN_C,
+		 {bombe::RotorModel::M_GAMMA, bombe::RotorModel::M_VI, bombe::RotorModel::M_VII, bombe::RotorModel::M_VIII},
+		 "RING",
+		 "GRUN"},
+	};
+
+	// Long enough to wrap the slow rotor more than once
+	const size_t length = 40000;
+	std::vector<bombe::Letter> input(length);
+	for(size_t k = 0; k < length; ++k)
+	{
+		input[k] = static_cast<bombe::Letter>((k * 7 + k / 26) % bombe::NUM_LETTERS);
+	}
+
+	for(const auto& setting : settings)
+	{
+		bombe::Enigma enigma(setting.reflector_model, setting.rotor_models);
+		enigma.configureSteckers("AB:CD:EF:GH");
+		enigma.configureRotors(setting.ringstellung, setting.grundstellung);
+		std::vector<bombe::Letter> expected(length);
+		enigma.process(input, expected);
+
+		for(const size_t offset :
+		    {size_t{0}, size_t{1}, size_t{25}, size_t{650}, size_t{16899}, size_t{23456}, length - 100})
+		{
+			enigma.seek(offset);
+			std::vector<bombe::Letter> actual(100);
+			enigma.process(std::span(input).subspan(offset, actual.size()), actual);
+			DOCTEST_CHECK(std::equal(actual.begin(), actual.end(), expected.begin() + offset));
+
+			const auto map = enigma.mapAt(offset + 50);
+			DOCTEST_CHECK_EQ(map[input[offset + 50]], expected[offset + 50]);
+		}
+	}
+}
+
+TEST_CASE("M4 with the Greek rotor at A matches M3")
+{
+	// Thin reflector B + beta at A is reflector B, thin C + gamma at A is reflector C
+	const std::vector<std::array<bombe::ReflectorModel, 2>> reflector_pairs = {
+		{bombe::ReflectorModel::THIN_B, bombe::ReflectorModel::REGULAR_B},
+		{bombe::ReflectorModel::THIN_C, bombe::ReflectorModel::REGULAR_C}};
+	const std::vector<bombe::RotorModel> greek_models = {bombe::RotorModel::M_BETA, bombe::RotorModel::M_GAMMA};
+	for(size_t k = 0; k < reflector_pairs.size(); ++k)
+	{
+		bombe::Scrambler m4(reflector_pairs[k][0],
+		                    std::vector{greek_models[k], bombe::RotorModel::M_V, bombe::RotorModel::M_II,
+		                                bombe::RotorModel::M_VIII});
+		bombe::Scrambler m3(reflector_pairs[k][1],
+		                    std::vector{bombe::RotorModel::M_V, bombe::RotorModel::M_II, bombe::RotorModel::M_VIII});
+		m4.setRotorPosition(0, 0);
+		for(bombe::Letter position = 0; position < bombe::NUM_LETTERS; ++position)
+		{
+			for(size_t r = 0; r < 3; ++r)
+			{
+				m4.setRotorPosition(r + 1, (position * (r + 7)) % bombe::NUM_LETTERS);
+				m3.setRotorPosition(r, (position * (r + 7)) % bombe::NUM_LETTERS);
+			}
+			DOCTEST_CHECK_EQ(bombe::printMap(std::span(m4.map()).first(bombe::NUM_LETTERS)),
+			                 bombe::printMap(std::span(m3.map()).first(bombe::NUM_LETTERS)));
+		}
+	}
+}
+
+TEST_CASE("Rewirable reflector plugged as reflector C matches reflector C")
+{
+	const std::vector rotor_models = {bombe::RotorModel::M_IV, bombe::RotorModel::M_I, bombe::RotorModel::M_V};
+	bombe::Enigma regular(bombe::ReflectorModel::REGULAR_C, rotor_models);
+	bombe::Enigma rewired(bombe::ReflectorModel::REGULAR_B, rotor_models);
+	for(auto* enigma : {&regular, &rewired})
+	{
+		enigma->configureSteckers("AV:BS:CG:DL");
+		enigma->configureRotors("BUL", "RZE");
+	}
+	rewired.configureReflectorWiring("AF:BV:CP:DJ:EI:GO:HY:KR:LZ:MX:NW:QT:SU");
+
+	const std::string plaintext = "DERFUEHRERISTTODXDERKAMPFGEHTWEITER";
+	std::string expected(plaintext.size(), ' ');
+	std::string actual(plaintext.size(), ' ');
+	regular.process(plaintext, expected);
+	rewired.process(plaintext, actual);
+	DOCTEST_CHECK_EQ(actual, expected);
+
+	DOCTEST_CHECK_THROWS_AS(bombe::parseReflectorWiring("AF:BV:CP"), std::invalid_argument);
+	// S plugged to itself
+	constexpr std::string_view SELF_PAIRED = "AF:BV:CP:DJ:EI:GO:HY:KR:LZ:MX:NW:QT:SS";
+	DOCTEST_CHECK_THROWS_AS(bombe::parseReflectorWiring(SELF_PAIRED), std::invalid_argument);
+	bombe::Enigma m4(bombe::ReflectorModel::THIN_B,
+	                 std::vector{bombe::RotorModel::M_BETA, bombe::RotorModel::M_I, bombe::RotorModel::M_II,
+	                             bombe::RotorModel::M_III});
+	// A valid wiring, but a rewirable reflector needs three rotors
+	constexpr std::string_view VALID_WIRING = "AF:BV:CP:DJ:EI:GO:HY:KR:LZ:MX:NW:QT:SU";
+	DOCTEST_CHECK_THROWS_AS(m4.configureReflectorWiring(VALID_WIRING), std::invalid_argument);
+}
+
+TEST_CASE("SIMD rotor composition matches the scalar kernel")
+{
+	const auto scalar = bombe::rotorComposer(bombe::SimdLevel::SCALAR);
+	std::mt19937_64 rng(FIXTURE_SEED);
+	for(auto level = bombe::SimdLevel::SSSE3; level <= bombe::detectSimdLevel();
+	    level = static_cast<bombe::SimdLevel>(static_cast<int>(level) + 1))
+	{
+		const auto composer = bombe::rotorComposer(level);
+		for(size_t model = 1; model <= 8; ++model)
+		{
+			const auto& wiring = bombe::rotorWiring(static_cast<bombe::RotorModel>(model));
+			// Random permutations as left maps, so every lookup index occurs
+			bombe::DoubleMap left_map = bombe::nullDoubleMap();
+			for(bombe::Letter position = 0; position < bombe::NUM_LETTERS; ++position)
+			{
+				std::shuffle(left_map.begin(), left_map.begin() + bombe::NUM_LETTERS, rng);
+				bombe::extendMap(left_map);
+				bombe::DoubleMap expected;
+				bombe::DoubleMap actual;
+				actual.fill(0xFF);
+				scalar(wiring.inward_map, wiring.outward_map, position, left_map, expected);
+				composer(wiring.inward_map, wiring.outward_map, position, left_map, actual);
+				DOCTEST_CHECK_EQ(bombe::printMap(actual), bombe::printMap(expected));
+			}
+		}
+	}
+	const auto unsupported = static_cast<bombe::SimdLevel>(static_cast<int>(bombe::detectSimdLevel()) + 1);
+	DOCTEST_CHECK_THROWS_AS(bombe::rotorComposer(unsupported), std::invalid_argument);
+}
+
+TEST_CASE("Ring settings recovered from a stop")
+{
+	// Operation Barbarossa message #1 (ring BUL, start BLA): the middle rotor steps within the message, so the fast
+	// ring is determined, while the middle ring is not
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_II, bombe::RotorModel::M_IV, bombe::RotorModel::M_V};
+	const std::string_view steckers = "AV:BS:CG:DL:FU:HZ:IN:KM:OW:RX";
+	const auto ciphertext = removeSpaces(
+		"EDPUD NRGYS ZRCXN UYTPO MRMBO FKTBZ REZKM LXLVE FGUEY SIOZV EQMIK UBPMM YLKLT TDEIS MDICA GYKUA CTCDO MOHWX "
+		"MUUIA UBSTS LRNBZ SZWNR FXWFY SSXJZ VIJHI DISHP RKLKA YUPAD TXQSP INQMA TLPIF SVKDA SCTAC DPBOP VHJK");
+	const auto plaintext = removeSpaces(
+		"AUFKL XABTE ILUNG XVONX KURTI NOWAX KURTI NOWAX NORDW ESTLX SEBEZ XSEBE ZXUAF FLIEG ERSTR ASZER IQTUN GXDUB "
+		"ROWKI XDUBR OWKIX OPOTS CHKAX OPOTS CHKAX UMXEI NSAQT DREIN ULLXU HRANG ETRET ENXAN GRIFF XINFX RGTX");
+
+	// Core positions of the letter at the stop offset, as a bombe would report them
+	const size_t position_offset = 40;
+	bombe::Rotor middle_rotor(rotor_models[1]);
+	bombe::Rotor fast_rotor(rotor_models[2]);
+	middle_rotor.setRing(bombe::char2Letter('U'));
+	fast_rotor.setRing(bombe::char2Letter('L'));
+	const bombe::SteppingSchedule schedule({0, 17, 15}, middle_rotor.turnovers(), fast_rotor.turnovers());
+	const auto positions = schedule.positionsAfter(position_offset + 1);
+
+	bombe::Stop stop{};
+	stop.reflector_model = bombe::ReflectorModel::REGULAR_B;
+	stop.num_rotors = 3;
+	stop.wheel_order = bombe::encodeWheelOrder(rotor_models);
+	stop.position_index = bombe::encodePositions(positions);
+
+	for(const size_t num_threads : {size_t{1}, size_t{3}})
+	{
+		const auto candidates = bombe::recoverRingSettings(stop, position_offset, steckers, ciphertext, 5, num_threads);
+		DOCTEST_REQUIRE_EQ(candidates.size(), size_t{5});
+		DOCTEST_CHECK_EQ(candidates[0].plaintext, plaintext);
+		DOCTEST_CHECK_EQ(candidates[0].ringstellung[2], 'L');
+		for(size_t k = 1; k < candidates.size(); ++k)
+		{
+			DOCTEST_CHECK(candidates[k].score <= candidates[k - 1].score);
+			DOCTEST_CHECK_NE(candidates[k].plaintext, plaintext);
+		}
+
+		bombe::Enigma enigma(stop.reflector_model, rotor_models);
+		enigma.configureSteckers(steckers);
+		enigma.configureRotors(candidates[0].ringstellung, candidates[0].grundstellung);
+		std::string decrypted(ciphertext.size(), ' ');
+		enigma.process(ciphertext, decrypted);
+		DOCTEST_CHECK_EQ(decrypted, plaintext);
+	}
+}
+
+TEST_CASE("Banburismus ranks the fast rotor first")
+{
+	const std::string text = removeSpaces(
+		"KOMMANDIERENDERX GENERALX DERX PANZERGRUPPEX MELDETX FEINDLICHEX KRAEFTEX STEHENX MITX STARKENX TEILENX "
+		"NOERDLICHX DESX FLUSSESX EIGENEX VORAUSABTEILUNGENX HABENX DIEX BRUECKEX BEIX DERX STADTX GENOMMENX UNDX "
+		"GEHENX WEITERX NACHX OSTENX VORX MUNITIONX UNDX BETRIEBSSTOFFX SINDX KNAPPX NACHSCHUBX WIRDX DRINGENDX "
+		"ERBETENX WETTERX KLARX SICHTX GUTX FEINDLICHEX FLIEGERTAETIGKEITX GERINGX DIEX DIVISIONX GREIFTX MORGENX "
+		"FRUEHX UMX FUENFX UHRX ANX DASX REGIMENTX STEHTX BEREITX ZUMX ANGRIFFX AUFX DIEX HOEHENX WESTLICHX DERX "
+		"STRASSEX VERLUSTEX BISHERX GERINGX GEFANGENEX WURDENX NACHX HINTENX GEBRACHT");
+
+	// Daily key: UKW B, rotors I IV II, ring CKR. Message settings AB? and AC? put many messages in depth.
+	const std::vector<bombe::RotorModel> rotor_models = {
+		bombe::RotorModel::M_I, bombe::RotorModel::M_IV, bombe::RotorModel::M_II};
+	std::mt19937 rng(FIXTURE_SEED);
+	std::vector<bombe::BanburismusMessage> messages;
+	for(size_t k = 0; k < 50; ++k)
+	{
+		auto& message = messages.emplace_back();
+		message.indicator = {'A', static_cast<char>('B' + rng() % 2), static_cast<char>('A' + rng() % 26)};
+		std::string plaintext(150, ' ');
+		const size_t start = rng() % text.size();
+		for(size_t j = 0; j < plaintext.size(); ++j)
+		{
+			plaintext[j] = text[(start + j) % text.size()];
+		}
+
+		bombe::Enigma enigma(bombe::ReflectorModel::REGULAR_B, rotor_models);
+		enigma.configureSteckers("AQ:BJ:CL:DZ:EW:FT");
+		enigma.configureRotors("CKR", message.indicator);
+		message.ciphertext.resize(plaintext.size());
+		enigma.process(plaintext, message.ciphertext);
+	}
+
+	const bombe::Banburismus banburismus(3, messages);
+	for(const auto& [m1, m2, offset] : {std::tuple{0, 1, 0}, {3, 7, 5}, {12, 4, 70}, {9, 9, 149}, {2, 5, 150}})
+	{
+		size_t expected = 0;
+		for(size_t k = offset; k < messages[m1].ciphertext.size(); ++k)
+		{
+			expected += (messages[m1].ciphertext[k] == messages[m2].ciphertext[k - offset]) ? 1 : 0;
+		}
+		DOCTEST_CHECK_EQ(banburismus.countRepeats(m1, m2, offset), expected);
+	}
+
+	const bombe::WheelOrderRules rules(3);
+	const auto hypotheses = banburismus.rankWheels(rules, 20, 3);
+	DOCTEST_REQUIRE_EQ(hypotheses.size(), size_t{20});
+	DOCTEST_CHECK_EQ(hypotheses[0].fast_rotor, bombe::RotorModel::M_II);
+	DOCTEST_CHECK(hypotheses[0].decibans > 0);
+	for(const auto& hypothesis : hypotheses)
+	{
+		if(hypothesis.fast_rotor != bombe::RotorModel::M_II)
+		{
+			DOCTEST_CHECK(hypothesis.decibans < hypotheses[0].decibans - 20);
+		}
+	}
+	DOCTEST_CHECK_EQ(banburismus.rankWheels(rules, 20, 1)[0].decibans, hypotheses[0].decibans);
+
+	// The middle rotor never reaches a turnover, so all middle rotors tie
+	const auto num_best = static_cast<size_t>(std::count_if(hypotheses.begin(), hypotheses.end(), [&](const auto& h) {
+		return h.decibans == hypotheses[0].decibans;
+	}));
+	DOCTEST_CHECK_EQ(num_best, size_t{4});
+	auto reduced_rules = rules;
+	reduced_rules.parseRules(bombe::slotRules(std::span(hypotheses).first(num_best), 3));
+	DOCTEST_CHECK(reduced_rules.admits({bombe::ReflectorModel::REGULAR_B, rotor_models}));
+	const std::vector<bombe::RotorModel> excluded_models = {
+		bombe::RotorModel::M_I, bombe::RotorModel::M_II, bombe::RotorModel::M_IV};
+	DOCTEST_CHECK_FALSE(reduced_rules.admits({bombe::ReflectorModel::REGULAR_B, excluded_models}));
+}